@@ -0,0 +1,150 @@
+// AntialiasedRasterizer.cpp
+#include "AntialiasedRasterizer.h"
+#include "SimdFloat.h"
+
+GammaTables::GammaTables() {
+    for (int i = 0; i < 256; i++) {
+        double value = i / 255.0;
+        linear[i] = float(value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4));
+    }
+    for (int i = 0; i <= encodeSteps; i++) {
+        double value = double(i) / encodeSteps;
+        double srgb = value <= 0.0031308 ? value * 12.92 : 1.055 * std::pow(value, 1.0 / 2.4) - 0.055;
+        encoded[i] = uint8_t(std::lround(srgb * 255.0));
+    }
+}
+
+const GammaTables& GammaTables::get() {
+    static const GammaTables tables;
+    return tables;
+}
+
+CoverageAccumulator::CoverageAccumulator(const PixelRect& rect)
+        : gamma(GammaTables::get()), width(0), height(0), pending(false) {
+    reset(rect);
+}
+
+void CoverageAccumulator::reset(const PixelRect& newRect) {
+    rect = newRect;
+    width = size_t(std::max(0LL, rect.maxX - rect.minX));
+    height = size_t(std::max(0LL, rect.maxY - rect.minY));
+    if (coverage.size() < width * height + 1) {
+        coverage.resize(width * height + 1, 0.0f);
+        color.resize(coverage.size() * 3, 0.0f);
+    }
+}
+
+void CoverageAccumulator::resolveIndex(Framebuffer& framebuffer, size_t index) {
+    float total = coverage[index];
+    float alpha = std::min(1.0f, total);
+    uint8_t* pixel = framebuffer.getRow(int(rect.minY + index / width)) + (rect.minX + index % width) * 3;
+    for (int channel = 0; channel < 3; channel++) {
+        float target = gamma.toLinear(pixel[channel]);
+        float source = color[index * 3 + channel] / total;
+        pixel[channel] = gamma.toSrgb(target + (source - target) * alpha);
+        color[index * 3 + channel] = 0.0f;
+    }
+    coverage[index] = 0.0f;
+}
+
+void CoverageAccumulator::resolveAll(Framebuffer& framebuffer) {
+    if (!pending) return;
+    pending = false;
+
+    size_t pixelCount = width * height;
+    for (size_t index = 0; index < pixelCount; index++) {
+        if (coverage[index] > 0.0f) resolveIndex(framebuffer, index);
+    }
+
+    // Splats that fell outside the rectangle are dropped
+    coverage[pixelCount] = 0.0f;
+    color[pixelCount * 3] = color[pixelCount * 3 + 1] = color[pixelCount * 3 + 2] = 0.0f;
+}
+
+void drawSmoothLine(Framebuffer& framebuffer, const SmoothLine& line, const PixelRect& clip,
+                    CoverageAccumulator* accumulator) {
+    bool yMajor = std::abs(line.y1 - line.y0) > std::abs(line.x1 - line.x0);
+    float start = yMajor ? line.y0 : line.x0;
+    float end = yMajor ? line.y1 : line.x1;
+    float minorStart = yMajor ? line.x0 : line.y0;
+    float minorEnd = yMajor ? line.x1 : line.y1;
+    if (start > end) {
+        std::swap(start, end);
+        std::swap(minorStart, minorEnd);
+    }
+    // A line without length covers nothing
+    if (end <= start) return;
+    float gradient = (minorEnd - minorStart) / (end - start);
+
+    long long majorMin = yMajor ? clip.minY : clip.minX;
+    long long majorMax = yMajor ? clip.maxY : clip.maxX;
+    long long minorMin = yMajor ? clip.minX : clip.minY;
+    long long minorMax = yMajor ? clip.maxX : clip.maxY;
+    long long first = std::max(majorMin, (long long)std::floor(start));
+    long long last = std::min(majorMax - 1, (long long)std::floor(end));
+
+    const GammaTables& gamma = GammaTables::get();
+    float color[3] = {gamma.toLinear(line.color.r), gamma.toLinear(line.color.g), gamma.toLinear(line.color.b)};
+
+    auto blend = [&](long long major, long long minor, float coverage) {
+        if (minor < minorMin || minor >= minorMax || coverage <= 0.0f) return;
+        if (accumulator) {
+            if (yMajor) {
+                accumulator->resolve(framebuffer, minor, major);
+            } else {
+                accumulator->resolve(framebuffer, major, minor);
+            }
+        }
+        uint8_t* pixel = yMajor ? framebuffer.getRow(int(major)) + minor * 3
+                                : framebuffer.getRow(int(minor)) + major * 3;
+        for (int channel = 0; channel < 3; channel++) {
+            float target = gamma.toLinear(pixel[channel]);
+            pixel[channel] = gamma.toSrgb(target + (color[channel] - target) * coverage);
+        }
+    };
+
+    const int width = FloatBatch::width;
+    FloatBatch lanes = FloatBatch::lanes();
+    FloatBatch one = FloatBatch::broadcast(1.0f);
+    FloatBatch zero = FloatBatch::broadcast(0.0f);
+    FloatBatch half = FloatBatch::broadcast(0.5f);
+    FloatBatch startBatch = FloatBatch::broadcast(start);
+    FloatBatch endBatch = FloatBatch::broadcast(end);
+    FloatBatch minorBatch = FloatBatch::broadcast(minorStart);
+    FloatBatch gradientBatch = FloatBatch::broadcast(gradient);
+
+    float rows[width];
+    float lower[width];
+    float upper[width];
+    for (long long base = first; base <= last; base += width) {
+        // Every column is computed from its own index, so a column gets the same value in any batch
+        FloatBatch column = FloatBatch::broadcast(float(base)) + lanes;
+
+        // Part of the column the line spans, which fades the endpoints in
+        FloatBatch weight = max(zero, min(column + one, endBatch) - max(column, startBatch));
+
+        // Minor position at the column center, split over the two pixel rows around it
+        FloatBatch position = minorBatch + gradientBatch * (column + half - startBatch) - half;
+        FloatBatch row = floor(position);
+        FloatBatch fraction = position - row;
+
+        row.store(rows);
+        (weight * (one - fraction)).store(lower);
+        (weight * fraction).store(upper);
+
+        int count = int(std::min<long long>(width, last - base + 1));
+        for (int lane = 0; lane < count; lane++) {
+            long long minor = (long long)rows[lane];
+            blend(base + lane, minor, lower[lane]);
+            blend(base + lane, minor + 1, upper[lane]);
+        }
+    }
+}
+
+void drawSmoothLines(Framebuffer& framebuffer, const std::vector<SmoothLine>& lines) {
+    PixelRect bounds = framebuffer.getBounds();
+    CoverageAccumulator accumulator(bounds);
+    std::vector<size_t> indices(lines.size());
+    for (size_t i = 0; i < indices.size(); i++) indices[i] = i;
+    drawSmoothLines(framebuffer, lines, indices, bounds, accumulator);
+}
@@ -0,0 +1,185 @@
+// AntialiasedRasterizer.h
+#ifndef ANTIALIASEDRASTERIZER_H
+#define ANTIALIASEDRASTERIZER_H
+
+#include "SoftwareRasterizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Line with sub-pixel endpoints in pixel coordinates; pixel (x, y) covers [x, x + 1) x [y, y + 1)
+struct SmoothLine {
+    float x0, y0, x1, y1;
+    PixelColor color;
+};
+
+// Converts 8-bit sRGB values to linear light and back, so coverage is blended like light adds up
+class GammaTables {
+private:
+    static const int encodeSteps = 8192;
+
+    float linear[256];
+    uint8_t encoded[encodeSteps + 1];
+
+    GammaTables();
+
+public:
+    static const GammaTables& get();
+
+    float toLinear(uint8_t value) const {
+        return linear[value];
+    }
+
+    // value is clamped to [0, 1]
+    uint8_t toSrgb(float value) const {
+        int index = int(value * encodeSteps + 0.5f);
+        return encoded[index < 0 ? 0 : (index > encodeSteps ? encodeSteps : index)];
+    }
+};
+
+// Segments shorter than a pixel are splatted instead of drawn; dense curves consist mostly of those
+inline bool isSubPixel(const SmoothLine& line) {
+    float dx = line.x1 - line.x0;
+    float dy = line.y1 - line.y0;
+    return dx * dx + dy * dy < 1.0f;
+}
+
+// Sums the coverage of sub-pixel segments per pixel of a rectangle, so they are blended once per pixel instead
+// of running the line algorithm for each of them. A splat adds the length of the segment, which is the area
+// it covers of a one pixel wide line, to the pixel of its midpoint. Pixels a full line is about to blend are
+// resolved first, so every pixel still sees its contributions in the order of the lines.
+class CoverageAccumulator {
+private:
+    const GammaTables& gamma;
+    PixelRect rect;
+    size_t width, height;
+
+    // Per pixel, plus one spare entry that takes the splats outside rect: coverage and the linear color
+    // weighted by it
+    std::vector<float> coverage;
+    std::vector<float> color;
+
+    // Whether anything was splatted since the last resolveAll, so lines without splats skip the lookups
+    bool pending;
+
+    void resolveIndex(Framebuffer& framebuffer, size_t index);
+
+public:
+    explicit CoverageAccumulator(const PixelRect& rect);
+
+    // Starts over on another rectangle; everything must have been resolved
+    void reset(const PixelRect& rect);
+
+    // Branch-free: one pixel and four adds per segment
+    void splat(const SmoothLine& line) {
+        float dx = line.x1 - line.x0;
+        float dy = line.y1 - line.y0;
+        float length = std::sqrt(dx * dx + dy * dy);
+
+        // Positions left of or below rect wrap around to huge unsigned values and land in the spare entry too
+        size_t column = size_t((long long)std::floor((line.x0 + line.x1) * 0.5f) - rect.minX);
+        size_t row = size_t((long long)std::floor((line.y0 + line.y1) * 0.5f) - rect.minY);
+        bool inside = column < width && row < height;
+        size_t index = inside ? row * width + column : width * height;
+
+        pending = true;
+        coverage[index] += length;
+        color[index * 3] += gamma.toLinear(line.color.r) * length;
+        color[index * 3 + 1] += gamma.toLinear(line.color.g) * length;
+        color[index * 3 + 2] += gamma.toLinear(line.color.b) * length;
+    }
+
+    // Blends the coverage pending at pixel (x, y), if any
+    void resolve(Framebuffer& framebuffer, long long x, long long y) {
+        if (!pending) return;
+        size_t index = size_t(y - rect.minY) * width + size_t(x - rect.minX);
+        if (coverage[index] > 0.0f) resolveIndex(framebuffer, index);
+    }
+
+    void resolveAll(Framebuffer& framebuffer);
+};
+
+// Draws a one pixel wide anti-aliased line in the style of Wu: every column along the major axis is split
+// over the two pixels nearest to the line, weighted by distance and by how much of the column the line spans.
+// The positions and coverages of several columns are computed at once with FloatBatch. Only pixels in clip
+// are written, and every pixel gets the same value as without clipping. Coverage pending in accumulator,
+// which must span clip, is resolved before a pixel is blended.
+void drawSmoothLine(Framebuffer& framebuffer, const SmoothLine& line, const PixelRect& clip,
+                    CoverageAccumulator* accumulator = nullptr);
+
+// Draws lines in order within clip, splatting the sub-pixel ones into accumulator, which must span clip.
+// Indices gives the position in lines of every line to draw.
+template <typename Indices>
+void drawSmoothLines(Framebuffer& framebuffer, const std::vector<SmoothLine>& lines, const Indices& indices,
+                     const PixelRect& clip, CoverageAccumulator& accumulator) {
+    for (auto index : indices) {
+        const SmoothLine& line = lines[index];
+        if (isSubPixel(line)) {
+            accumulator.splat(line);
+        } else {
+            drawSmoothLine(framebuffer, line, clip, &accumulator);
+        }
+    }
+    accumulator.resolveAll(framebuffer);
+}
+
+// Draws lines one after the other on this thread; needs 16 bytes of coverage per pixel of the framebuffer
+void drawSmoothLines(Framebuffer& framebuffer, const std::vector<SmoothLine>& lines);
+
+// Calls visit(tileX, tileY) for every tile that drawing line may write when clipped to bounds; a few
+// extra tiles next to the line can be visited as well
+template <typename Visit>
+void forEachSmoothLineTile(const SmoothLine& line, const PixelRect& bounds, int tileSize, Visit visit) {
+    // A splat only writes the pixel of its midpoint
+    if (isSubPixel(line)) {
+        long long x = (long long)std::floor((line.x0 + line.x1) * 0.5f);
+        long long y = (long long)std::floor((line.y0 + line.y1) * 0.5f);
+        if (x >= bounds.minX && x < bounds.maxX && y >= bounds.minY && y < bounds.maxY) {
+            visit(x / tileSize, y / tileSize);
+        }
+        return;
+    }
+
+    bool yMajor = std::abs(line.y1 - line.y0) > std::abs(line.x1 - line.x0);
+    double start = yMajor ? line.y0 : line.x0;
+    double end = yMajor ? line.y1 : line.x1;
+    double minorStart = yMajor ? line.x0 : line.y0;
+    double minorEnd = yMajor ? line.x1 : line.y1;
+    if (start > end) {
+        std::swap(start, end);
+        std::swap(minorStart, minorEnd);
+    }
+    if (end <= start) return;
+    double gradient = (minorEnd - minorStart) / (end - start);
+
+    long long majorMin = yMajor ? bounds.minY : bounds.minX;
+    long long majorMax = yMajor ? bounds.maxY : bounds.maxX;
+    long long minorMin = yMajor ? bounds.minX : bounds.minY;
+    long long minorMax = yMajor ? bounds.maxX : bounds.maxY;
+
+    long long first = std::max(majorMin, (long long)std::floor(start));
+    long long last = std::min(majorMax - 1, (long long)std::floor(end));
+    while (first <= last) {
+        long long majorTile = first / tileSize;
+        long long spanLast = std::min(last, (majorTile + 1) * tileSize - 1);
+
+        // The rows written are the two around the line at every column center; one row of margin
+        // on each side absorbs rounding in single precision
+        double minorA = minorStart + gradient * (first + 0.5 - start);
+        double minorB = minorStart + gradient * (spanLast + 0.5 - start);
+        long long rowFirst = std::max(minorMin, (long long)std::floor(std::min(minorA, minorB) - 0.5) - 1);
+        long long rowLast = std::min(minorMax - 1, (long long)std::floor(std::max(minorA, minorB) - 0.5) + 2);
+        for (long long row = rowFirst; row <= rowLast; row += tileSize - row % tileSize) {
+            if (yMajor) {
+                visit(row / tileSize, majorTile);
+            } else {
+                visit(majorTile, row / tileSize);
+            }
+        }
+        first = spanLast + 1;
+    }
+}
+
+#endif // ANTIALIASEDRASTERIZER_H
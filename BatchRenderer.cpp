@@ -0,0 +1,120 @@
+// BatchRenderer.cpp
+#include "BatchRenderer.h"
+#include "DeepZoom.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <set>
+
+namespace {
+    double megapixels(size_t pixelCount) {
+        return pixelCount / 1e6;
+    }
+
+    // Raw pixel data, 3 bytes per pixel, in megabytes
+    double pixelMegabytes(size_t pixelCount) {
+        return pixelCount * 3 / (1024.0 * 1024.0);
+    }
+
+    double perSecond(double amount, double seconds) {
+        return amount / std::max(seconds, 1e-9);
+    }
+}
+
+std::vector<BatchResult> renderBatch(const std::vector<std::string>& iniFiles, const BatchOptions& options,
+                                     LSystemCache& cache) {
+    // A file listed twice would be written by two jobs at once, and so would two files with the same name in
+    // different directories when they share the output directory
+    std::vector<BatchResult> results;
+    std::vector<size_t> pending;
+    std::set<std::string> listed;
+    std::set<std::string> outputs;
+    for (const std::string& file : iniFiles) {
+        if (file.empty() || !listed.insert(file).second) continue;
+        BatchResult result;
+        result.iniFileName = file;
+        result.outputFileName = outputFileName(file, options.deepZoom ? "dzi" : options.format,
+                                               options.outputDirectory);
+        if (!outputs.insert(result.outputFileName).second) {
+            std::cerr << result.outputFileName << " is the output of an earlier file as well; " << file
+                      << " is not rendered" << std::endl;
+        } else if (!options.overwrite && std::filesystem::exists(result.outputFileName)) {
+            std::cerr << result.outputFileName << " exists already; " << file
+                      << " is not rendered without --force" << std::endl;
+        } else {
+            pending.push_back(results.size());
+        }
+        results.push_back(result);
+    }
+
+    // Files render on every worker and on this thread at once, and share the memory budget between them
+    size_t concurrentFiles = std::max<size_t>(1, std::min<size_t>(pending.size(), jobSystem().getThreadCount() + 1));
+    size_t memoryBudget = options.memoryBudget / concurrentFiles;
+
+    // Every file renders its own lines in parallel as well, so a single large file still uses all workers
+    parallelFor(0, pending.size(), 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            BatchResult& result = results[pending[i]];
+            auto start = std::chrono::steady_clock::now();
+            if (options.deepZoom) {
+                result.rendered = renderIniToDeepZoom(result.iniFileName, result.outputFileName, &cache);
+            } else {
+                result.rendered = renderIniToImage(result.iniFileName, result.outputFileName, memoryBudget,
+                                                   &result.timings, &cache);
+            }
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    });
+    return results;
+}
+
+void printBatchSummary(std::ostream& out, const std::vector<BatchResult>& results, double seconds,
+                       const LSystemCache& cache) {
+    size_t nameWidth = 4;
+    for (const BatchResult& result : results) {
+        nameWidth = std::max(nameWidth, result.outputFileName.size());
+    }
+
+    out << std::left << std::setw(int(nameWidth)) << "File" << std::right << std::setw(10) << "Mpixels"
+        << std::setw(10) << "Render s" << std::setw(10) << "Encode s" << std::setw(10) << "Total s"
+        << std::setw(12) << "Mpixel/s" << std::setw(12) << "Encode MB/s" << "\n";
+
+    size_t rendered = 0;
+    size_t pixelCount = 0;
+    out << std::fixed;
+    for (const BatchResult& result : results) {
+        out << std::left << std::setw(int(nameWidth)) << result.outputFileName << std::right;
+        if (!result.rendered) {
+            out << "  failed\n";
+            continue;
+        }
+        rendered++;
+        pixelCount += result.timings.pixelCount;
+
+        // Deep Zoom pyramids are timed as a whole
+        if (result.timings.pixelCount == 0) {
+            out << std::setw(10) << "-" << std::setw(10) << "-" << std::setw(10) << "-"
+                << std::setw(10) << std::setprecision(3) << result.seconds << "\n";
+            continue;
+        }
+        const RenderTimings& timings = result.timings;
+        out << std::setprecision(2) << std::setw(10) << megapixels(timings.pixelCount)
+            << std::setprecision(3) << std::setw(10) << timings.renderSeconds << std::setw(10)
+            << timings.encodeSeconds << std::setw(10) << result.seconds
+            << std::setprecision(1) << std::setw(12) << perSecond(megapixels(timings.pixelCount), result.seconds)
+            << std::setw(12) << perSecond(pixelMegabytes(timings.pixelCount), timings.encodeSeconds) << "\n";
+    }
+
+    out << std::setprecision(3) << "Rendered " << rendered << " of " << results.size() << " files in " << seconds
+        << " s";
+    if (pixelCount > 0) {
+        out << std::setprecision(1) << ", " << perSecond(megapixels(pixelCount), seconds) << " Mpixel/s";
+    }
+    out << "; L-System files parsed " << cache.getSystemLoads() << " of " << cache.getSystemRequests()
+        << " times, expanded " << cache.getExpansionLoads() - cache.getExpansionDiskLoads() << " of "
+        << cache.getExpansionRequests() << " times (" << cache.getExpansionDiskLoads() << " read from disk)"
+        << std::defaultfloat << std::endl;
+}
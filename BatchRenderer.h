@@ -0,0 +1,41 @@
+// BatchRenderer.h
+#ifndef BATCHRENDERER_H
+#define BATCHRENDERER_H
+
+#include "HeadlessRenderer.h"
+#include "LSystemCache.h"
+#include <ostream>
+#include <string>
+#include <vector>
+
+// How the files of a batch are written
+struct BatchOptions {
+    std::string format = "bmp";    // of the images; Deep Zoom tiles are always PNG
+    bool deepZoom = false;
+    size_t memoryBudget = defaultMemoryBudget;    // shared by the images rendered at once
+    std::string outputDirectory;    // next to the ini files when empty
+    bool overwrite = false;         // whether existing outputs are replaced
+};
+
+// One file of a batch and what became of it
+struct BatchResult {
+    std::string iniFileName;
+    std::string outputFileName;
+    bool rendered = false;
+    double seconds = 0;
+    RenderTimings timings;    // images only
+};
+
+// Renders every ini file to an image named after it with the extension of options.format, or to the Deep Zoom
+// pyramid name.dzi, next to it or in options.outputDirectory. The files are rendered concurrently on the job
+// system, one job each, and their L-System files and expansions come from cache. Empty and repeated names are
+// skipped; files whose output exists already, unless options.overwrite is set, or would be written by an
+// earlier file of the batch too, fail without rendering.
+std::vector<BatchResult> renderBatch(const std::vector<std::string>& iniFiles, const BatchOptions& options,
+                                     LSystemCache& cache);
+
+// Prints a line with the timings and throughput of every file, then the totals for a batch that took seconds
+void printBatchSummary(std::ostream& out, const std::vector<BatchResult>& results, double seconds,
+                       const LSystemCache& cache);
+
+#endif // BATCHRENDERER_H
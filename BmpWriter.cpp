@@ -0,0 +1,103 @@
+// BmpWriter.cpp
+#include "BmpWriter.h"
+#include <iostream>
+
+namespace {
+    const uint32_t fileHeaderSize = 14;
+    const uint32_t infoHeaderSize = 40;
+
+    // 300 dpi, as in the reference images
+    const int32_t pixelsPerMeter = 11811;
+
+    void putUint16(std::vector<uint8_t>& header, uint16_t value) {
+        header.push_back(uint8_t(value));
+        header.push_back(uint8_t(value >> 8));
+    }
+
+    void putUint32(std::vector<uint8_t>& header, uint32_t value) {
+        for (int shift = 0; shift < 32; shift += 8) {
+            header.push_back(uint8_t(value >> shift));
+        }
+    }
+
+    // Rows are padded to a multiple of four bytes
+    uint32_t rowStride(int width) {
+        return (uint32_t(width) * 3 + 3) & ~3u;
+    }
+}
+
+BmpWriter::BmpWriter()
+        : width(0), height(0), rowsWritten(0) {
+}
+
+bool BmpWriter::open(const std::string& fileName, int newWidth, int newHeight) {
+    width = newWidth;
+    height = newHeight;
+    rowsWritten = 0;
+    rowBuffer.assign(rowStride(width), 0);
+
+    out.open(fileName, std::ios::binary);
+    if (!out) {
+        std::cerr << "Failed to create image file: " << fileName << std::endl;
+        return false;
+    }
+
+    // Sizes past 4 GB do not fit the headers; readers compute them from the dimensions when they are 0
+    uint64_t fileSize = fileHeaderSize + infoHeaderSize + uint64_t(rowStride(width)) * uint64_t(height);
+    uint32_t imageSize = fileSize > UINT32_MAX ? 0 : uint32_t(fileSize) - fileHeaderSize - infoHeaderSize;
+    std::vector<uint8_t> header;
+    header.push_back('B');
+    header.push_back('M');
+    putUint32(header, fileSize > UINT32_MAX ? 0 : uint32_t(fileSize));
+    putUint32(header, 0);
+    putUint32(header, fileHeaderSize + infoHeaderSize);
+
+    putUint32(header, infoHeaderSize);
+    putUint32(header, uint32_t(width));
+    putUint32(header, uint32_t(height));
+    putUint16(header, 1);    // planes
+    putUint16(header, 24);   // bits per pixel
+    putUint32(header, 0);    // no compression
+    putUint32(header, imageSize);
+    putUint32(header, uint32_t(pixelsPerMeter));
+    putUint32(header, uint32_t(pixelsPerMeter));
+    putUint32(header, 0);
+    putUint32(header, 0);
+
+    out.write(reinterpret_cast<const char*>(header.data()), header.size());
+    return bool(out);
+}
+
+bool BmpWriter::writeRow(const uint8_t* rgb) {
+    if (rowsWritten >= height) return false;
+
+    // BMP stores blue, green, red
+    for (int x = 0; x < width; x++) {
+        rowBuffer[x * 3] = rgb[x * 3 + 2];
+        rowBuffer[x * 3 + 1] = rgb[x * 3 + 1];
+        rowBuffer[x * 3 + 2] = rgb[x * 3];
+    }
+    out.write(reinterpret_cast<const char*>(rowBuffer.data()), rowBuffer.size());
+    rowsWritten++;
+    return bool(out);
+}
+
+bool BmpWriter::close() {
+    bool complete = rowsWritten == height && bool(out);
+    out.close();
+    return complete;
+}
+
+int BmpWriter::getRowsWritten() const {
+    return rowsWritten;
+}
+
+bool writeBmp(const std::string& fileName, const Framebuffer& framebuffer) {
+    BmpWriter writer;
+    if (!writer.open(fileName, framebuffer.getWidth(), framebuffer.getHeight())) return false;
+
+    for (int y = 0; y < framebuffer.getHeight(); y++) {
+        writer.writeRow(framebuffer.getRow(framebuffer.getFirstRow() + y));
+    }
+    return writer.close();
+}
@@ -0,0 +1,39 @@
+// BmpWriter.h
+#ifndef BMPWRITER_H
+#define BMPWRITER_H
+
+#include "SoftwareRasterizer.h"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Writes a 24-bit BMP one row at a time, bottom row first, so the image never has to be in memory as a whole
+class BmpWriter {
+private:
+    std::ofstream out;
+    int width, height;
+    int rowsWritten;
+    std::vector<uint8_t> rowBuffer;
+
+public:
+    BmpWriter();
+
+    BmpWriter(const BmpWriter&) = delete;
+    BmpWriter& operator=(const BmpWriter&) = delete;
+
+    // Creates fileName and writes the headers
+    bool open(const std::string& fileName, int width, int height);
+
+    // rgb holds width pixels of three bytes each
+    bool writeRow(const uint8_t* rgb);
+
+    // Fails when rows are missing or anything could not be written
+    bool close();
+
+    int getRowsWritten() const;
+};
+
+bool writeBmp(const std::string& fileName, const Framebuffer& framebuffer);
+
+#endif // BMPWRITER_H
@@ -0,0 +1,24 @@
+// ContentHash.cpp
+#include "ContentHash.h"
+
+ContentHash::ContentHash(char tag)
+        : value(14695981039346656037ull) {
+    add(&tag, 1);
+}
+
+void ContentHash::add(const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        value = (value ^ bytes[i]) * 1099511628211ull;
+    }
+}
+
+void ContentHash::add(const std::string& text) {
+    uint64_t size = text.size();
+    add(&size, sizeof(size));
+    add(text.data(), text.size());
+}
+
+uint64_t ContentHash::get() const {
+    return value;
+}
@@ -0,0 +1,26 @@
+// ContentHash.h
+#ifndef CONTENTHASH_H
+#define CONTENTHASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 64 bit FNV-1a over the content something is made from, used as the key of cached results
+class ContentHash {
+private:
+    uint64_t value;
+
+public:
+    // Keys of different kinds of entries start from different tags, so they never meet
+    explicit ContentHash(char tag);
+
+    void add(const void* data, size_t size);
+
+    // Adds the length first, so consecutive strings cannot run into each other
+    void add(const std::string& text);
+
+    uint64_t get() const;
+};
+
+#endif // CONTENTHASH_H
@@ -0,0 +1,158 @@
+// DeepZoom.cpp
+#include "DeepZoom.h"
+#include "JobSystem.h"
+#include "LevelOfDetail.h"
+#include "l_parser.h"
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    const char* const deepZoomTileFormat = "png";
+
+    // Level of the full image; level 0 is a single pixel
+    int maxDeepZoomLevel(int width, int height) {
+        int level = 0;
+        while ((1LL << level) < std::max(width, height)) level++;
+        return level;
+    }
+
+    // The view of level, which has 2^(maxLevel - level) times fewer pixels on each side than the full image
+    RasterView deepZoomLevelView(const RasterView& view, int maxLevel, int level) {
+        long long divisor = 1LL << (maxLevel - level);
+        RasterView levelView = view;
+        levelView.width = int((view.width + divisor - 1) / divisor);
+        levelView.height = int((view.height + divisor - 1) / divisor);
+        levelView.scaleX /= divisor;
+        levelView.scaleY /= divisor;
+        levelView.offsetX /= divisor;
+        levelView.offsetY /= divisor;
+        return levelView;
+    }
+
+    // The lines in pixels of the full image, where the simplification tolerances of the levels are measured
+    std::vector<LineData> toImagePixels(const std::vector<RasterLine>& lines, const RasterView& view) {
+        std::vector<LineData> pixelLines(lines.size());
+        for (size_t i = 0; i < lines.size(); i++) {
+            const RasterLine& line = lines[i];
+            pixelLines[i].start = glm::vec3(float(line.x0 * view.scaleX + view.offsetX),
+                                            float(line.y0 * view.scaleY + view.offsetY), 0.0f);
+            pixelLines[i].end = glm::vec3(float(line.x1 * view.scaleX + view.offsetX),
+                                          float(line.y1 * view.scaleY + view.offsetY), 0.0f);
+            pixelLines[i].color = glm::vec3(line.color.r / 255.0f, line.color.g / 255.0f, line.color.b / 255.0f);
+        }
+        return pixelLines;
+    }
+
+    std::vector<RasterLine> toRasterLines(const std::vector<LineData>& lines) {
+        std::vector<RasterLine> rasterLines(lines.size());
+        for (size_t i = 0; i < lines.size(); i++) {
+            const LineData& line = lines[i];
+            rasterLines[i] = RasterLine{line.start.x, line.start.y, line.end.x, line.end.y, toPixelColor(line.color)};
+        }
+        return rasterLines;
+    }
+
+    // Writes columns [x0, x1) of rows [top0, top1) as an image; Deep Zoom counts rows from the top
+    bool writeTile(const std::string& fileName, const Framebuffer& framebuffer, int x0, int x1, int top0, int top1) {
+        Framebuffer tile(x1 - x0, top1 - top0, PixelColor{0, 0, 0});
+        for (int y = 0; y < tile.getHeight(); y++) {
+            const uint8_t* row = framebuffer.getRow(framebuffer.getHeight() - top1 + y) + x0 * 3;
+            std::copy(row, row + tile.getWidth() * 3, tile.getRow(y));
+        }
+        return writeImage(fileName, tile);
+    }
+}
+
+bool writeDeepZoom(const RasterScene& scene, const std::string& dziFileName) {
+    std::string tilesDirectory = replaceExtension(dziFileName, "") + "_files";
+    int maxLevel = maxDeepZoomLevel(scene.view.width, scene.view.height);
+
+    std::ofstream dzi(dziFileName);
+    if (!dzi) {
+        std::cerr << "Failed to create Deep Zoom file: " << dziFileName << std::endl;
+        return false;
+    }
+    dzi << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        << "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" Format=\"" << deepZoomTileFormat << "\" Overlap=\""
+        << deepZoomOverlap << "\" TileSize=\"" << deepZoomTileSize << "\">\n"
+        << "  <Size Width=\"" << scene.view.width << "\" Height=\"" << scene.view.height << "\"/>\n"
+        << "</Image>\n";
+    dzi.close();
+    if (!dzi) return false;
+
+    // Each level below the full image is simplified from the one above it with the tolerance left over, so
+    // the work per level shrinks with its size while every level stays within half of its own pixel
+    Framebuffer framebuffer;
+    std::vector<LineData> simplified;
+    float simplifiedTolerance = 0.0f;
+    for (int level = maxLevel; level >= 0; level--) {
+        RasterView view = deepZoomLevelView(scene.view, maxLevel, level);
+        framebuffer.resize(view.width, view.height, scene.background);
+        if (level == maxLevel) {
+            rasterizeLines(scene.lines, view, framebuffer, scene.antialiased);
+        } else {
+            double divisor = double(1LL << (maxLevel - level));
+            float tolerance = 0.5f * float(divisor);
+            if (level == maxLevel - 1) simplified = toImagePixels(scene.lines, scene.view);
+            simplified = simplifyLines(simplified, tolerance - simplifiedTolerance);
+            simplifiedTolerance = tolerance;
+
+            RasterView pixelView = view;
+            pixelView.scaleX = pixelView.scaleY = 1.0 / divisor;
+            pixelView.offsetX = pixelView.offsetY = 0.0;
+            rasterizeLines(toRasterLines(simplified), pixelView, framebuffer, scene.antialiased);
+        }
+
+        std::string levelDirectory = tilesDirectory + "/" + std::to_string(level);
+        std::error_code error;
+        std::filesystem::create_directories(levelDirectory, error);
+        if (error) {
+            std::cerr << "Failed to create directory: " << levelDirectory << std::endl;
+            return false;
+        }
+
+        size_t columns = (size_t(view.width) + deepZoomTileSize - 1) / deepZoomTileSize;
+        size_t rows = (size_t(view.height) + deepZoomTileSize - 1) / deepZoomTileSize;
+        std::atomic<size_t> failures{0};
+        parallelFor(0, columns * rows, 1, [&](size_t first, size_t last) {
+            for (size_t tile = first; tile < last; tile++) {
+                int column = int(tile % columns);
+                int row = int(tile / columns);
+                int x0 = std::max(0, column * deepZoomTileSize - deepZoomOverlap);
+                int x1 = std::min(view.width, (column + 1) * deepZoomTileSize + deepZoomOverlap);
+                int top0 = std::max(0, row * deepZoomTileSize - deepZoomOverlap);
+                int top1 = std::min(view.height, (row + 1) * deepZoomTileSize + deepZoomOverlap);
+
+                std::string fileName = levelDirectory + "/" + std::to_string(column) + "_" + std::to_string(row) + "."
+                                       + deepZoomTileFormat;
+                if (!writeTile(fileName, framebuffer, x0, x1, top0, top1)) failures++;
+            }
+        });
+        if (failures > 0) return false;
+    }
+    return true;
+}
+
+bool renderIniToDeepZoom(const std::string& iniFileName, const std::string& dziFileName, LSystemCache* cache) {
+    try {
+        ini::Configuration conf;
+        if (!loadConfiguration(iniFileName, conf)) return false;
+
+        RasterScene scene;
+        if (!generateRasterScene(conf, scene, cache)) return false;
+        return writeDeepZoom(scene, dziFileName);
+    }
+    catch (ini::ParseException& ex) {
+        std::cerr << "Error parsing file: " << iniFileName << ": " << ex.what() << std::endl;
+    }
+    catch (LParser::ParserException& ex) {
+        std::cerr << "Error parsing L-System of " << iniFileName << ": " << ex.what() << std::endl;
+    }
+    catch (std::exception& ex) {
+        std::cerr << "Error rendering " << iniFileName << ": " << ex.what() << std::endl;
+    }
+    return false;
+}
@@ -0,0 +1,24 @@
+// DeepZoom.h
+#ifndef DEEPZOOM_H
+#define DEEPZOOM_H
+
+#include "HeadlessRenderer.h"
+#include <string>
+
+// Pixels on a side of a Deep Zoom tile, and the pixels every tile shares with its neighbours
+const int deepZoomTileSize = 254;
+const int deepZoomOverlap = 1;
+
+// Writes scene as a Deep Zoom (DZI) pyramid for web pan/zoom viewers: dziFileName describes the image and
+// name_files/level/column_row.png holds the tiles, in PNG since browsers cannot show QOI or BMP tiles. The
+// highest level has the size of the image, every level below it half the size of the one above, down to a
+// single pixel. Every level is drawn at its own scale, so lines stay one pixel wide at every zoom; levels below
+// the full image draw the lines simplified to within half of their pixel. The tiles of a level are encoded and
+// written in parallel.
+bool writeDeepZoom(const RasterScene& scene, const std::string& dziFileName);
+
+// Loads iniFileName and writes its image as a Deep Zoom pyramid, taking L-Systems from cache when given one
+bool renderIniToDeepZoom(const std::string& iniFileName, const std::string& dziFileName,
+                         LSystemCache* cache = nullptr);
+
+#endif // DEEPZOOM_H
@@ -0,0 +1,423 @@
+// Deflate.cpp
+#include "Deflate.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+
+namespace {
+    // LZ77 window, and the shortest and longest match deflate can express
+    const size_t windowSize = 32768;
+    const size_t minMatch = 3;
+    const size_t maxMatch = 258;
+
+    // Matches are found through chains of earlier positions with the same hash of their first three bytes
+    const int hashBits = 15;
+    const int maxChainLength = 32;
+
+    // Tokens per block; every block gets Huffman codes for its own symbols
+    const size_t blockTokens = 1 << 16;
+
+    const int literalCodes = 286;
+    const int distanceCodes = 30;
+    const int codeLengthCodes = 19;
+    const int endOfBlock = 256;
+
+    const uint16_t lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59,
+                                     67, 83, 99, 115, 131, 163, 195, 227, 258};
+    const uint8_t lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                     4, 4, 4, 4, 5, 5, 5, 5, 0};
+    const uint16_t distanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385,
+                                       513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    const uint8_t distanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8,
+                                       9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+    // Order in which the lengths of the code length code are stored
+    const uint8_t codeLengthOrder[codeLengthCodes] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2,
+                                                      14, 1, 15};
+
+    struct CrcTable {
+        uint32_t entries[256];
+
+        CrcTable() {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t crc = i;
+                for (int bit = 0; bit < 8; bit++) {
+                    crc = crc & 1 ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+                }
+                entries[i] = crc;
+            }
+        }
+    };
+
+    // Index of the code whose base is the largest one not above value
+    template <size_t N>
+    int findCode(const uint16_t (&base)[N], size_t value) {
+        return int(std::upper_bound(base, base + N, value) - base) - 1;
+    }
+
+    // Writes bits least significant first, as deflate stores them
+    class BitWriter {
+    private:
+        std::vector<uint8_t>& out;
+        uint64_t bits;
+        int count;
+
+    public:
+        explicit BitWriter(std::vector<uint8_t>& out) : out(out), bits(0), count(0) {}
+
+        void put(uint32_t value, int length) {
+            bits |= uint64_t(value) << count;
+            count += length;
+            while (count >= 8) {
+                out.push_back(uint8_t(bits));
+                bits >>= 8;
+                count -= 8;
+            }
+        }
+
+        void alignToByte() {
+            if (count > 0) put(0, 8 - count);
+        }
+    };
+
+    // Literal or length symbol, or a match when distance is not 0
+    struct Token {
+        uint16_t value;
+        uint16_t distance;
+    };
+
+    // Canonical Huffman code; the codes are stored bit reversed, ready for BitWriter
+    struct HuffmanCode {
+        std::vector<uint8_t> lengths;
+        std::vector<uint16_t> codes;
+
+        // Limits the code to maxLength bits. Every code gets at least two symbols, since inflaters
+        // reject incomplete codes.
+        void build(std::vector<uint32_t> frequencies, int maxLength) {
+            size_t symbolCount = frequencies.size();
+            for (size_t symbol = 0, used = size_t(std::count_if(frequencies.begin(), frequencies.end(),
+                                                              [](uint32_t f) { return f > 0; }));
+                 used < 2 && symbol < symbolCount; symbol++) {
+                if (frequencies[symbol] == 0) {
+                    frequencies[symbol] = 1;
+                    used++;
+                }
+            }
+
+            // Huffman tree: leaves first, then every merged node with the index of its parent
+            std::vector<size_t> parents;
+            std::vector<int> leafSymbols;
+            std::priority_queue<std::pair<uint64_t, size_t>, std::vector<std::pair<uint64_t, size_t>>,
+                                std::greater<std::pair<uint64_t, size_t>>> queue;
+            for (size_t symbol = 0; symbol < symbolCount; symbol++) {
+                if (frequencies[symbol] == 0) continue;
+                queue.push({frequencies[symbol], parents.size()});
+                parents.push_back(0);
+                leafSymbols.push_back(int(symbol));
+            }
+            while (queue.size() > 1) {
+                auto a = queue.top();
+                queue.pop();
+                auto b = queue.top();
+                queue.pop();
+                parents[a.second] = parents[b.second] = parents.size();
+                queue.push({a.first + b.first, parents.size()});
+                parents.push_back(0);
+            }
+
+            // Parents come after their children, so depths are filled in from the root down
+            std::vector<int> depths(parents.size(), 0);
+            for (size_t node = parents.size() - 1; node-- > 0;) {
+                depths[node] = depths[parents[node]] + 1;
+            }
+
+            // Move codes that are too long up, keeping the lengths a complete code, then hand the longest
+            // lengths to the least frequent symbols
+            std::vector<int> lengthCounts(leafSymbols.size() + maxLength + 1, 0);
+            for (size_t leaf = 0; leaf < leafSymbols.size(); leaf++) lengthCounts[depths[leaf]]++;
+            for (size_t length = maxLength + 1; length < lengthCounts.size(); length++) {
+                lengthCounts[maxLength] += lengthCounts[length];
+                lengthCounts[length] = 0;
+            }
+            uint64_t total = 0;
+            for (int length = maxLength; length > 0; length--) {
+                total += uint64_t(lengthCounts[length]) << (maxLength - length);
+            }
+            while (total != (uint64_t(1) << maxLength)) {
+                lengthCounts[maxLength]--;
+                for (int length = maxLength - 1; length > 0; length--) {
+                    if (lengthCounts[length] != 0) {
+                        lengthCounts[length]--;
+                        lengthCounts[length + 1] += 2;
+                        break;
+                    }
+                }
+                total--;
+            }
+
+            std::stable_sort(leafSymbols.begin(), leafSymbols.end(), [&](int a, int b) {
+                return frequencies[a] < frequencies[b];
+            });
+            lengths.assign(symbolCount, 0);
+            size_t next = 0;
+            for (int length = maxLength; length > 0; length--) {
+                for (int i = 0; i < lengthCounts[length]; i++) {
+                    lengths[leafSymbols[next++]] = uint8_t(length);
+                }
+            }
+
+            // Canonical codes: shorter codes first, symbols of the same length in order
+            std::vector<uint16_t> nextCode(maxLength + 2, 0);
+            std::vector<int> counts(maxLength + 1, 0);
+            for (uint8_t length : lengths) {
+                if (length) counts[length]++;
+            }
+            uint16_t code = 0;
+            for (int length = 1; length <= maxLength; length++) {
+                code = uint16_t((code + counts[length - 1]) << 1);
+                nextCode[length] = code;
+            }
+            codes.assign(symbolCount, 0);
+            for (size_t symbol = 0; symbol < symbolCount; symbol++) {
+                int length = lengths[symbol];
+                if (length == 0) continue;
+                uint16_t value = nextCode[length]++;
+                uint16_t reversed = 0;
+                for (int bit = 0; bit < length; bit++) {
+                    reversed = uint16_t((reversed << 1) | ((value >> bit) & 1));
+                }
+                codes[symbol] = reversed;
+            }
+        }
+
+        void put(BitWriter& bits, int symbol) const {
+            bits.put(codes[symbol], lengths[symbol]);
+        }
+    };
+
+    // Run-length encoded code lengths: symbol 16 repeats the previous length, 17 and 18 repeat zero
+    struct CodeLengthSymbol {
+        uint8_t symbol;
+        uint8_t extra;
+    };
+
+    void encodeCodeLengths(const std::vector<uint8_t>& lengths, std::vector<CodeLengthSymbol>& symbols) {
+        size_t i = 0;
+        while (i < lengths.size()) {
+            uint8_t length = lengths[i];
+            size_t run = 1;
+            while (i + run < lengths.size() && lengths[i + run] == length) run++;
+            i += run;
+
+            if (length == 0) {
+                while (run >= 11) {
+                    size_t count = std::min<size_t>(run, 138);
+                    symbols.push_back({18, uint8_t(count - 11)});
+                    run -= count;
+                }
+                if (run >= 3) {
+                    symbols.push_back({17, uint8_t(run - 3)});
+                    run = 0;
+                }
+            } else {
+                symbols.push_back({length, 0});
+                run--;
+                while (run >= 3) {
+                    size_t count = std::min<size_t>(run, 6);
+                    symbols.push_back({16, uint8_t(count - 3)});
+                    run -= count;
+                }
+            }
+            for (; run > 0; run--) symbols.push_back({length, 0});
+        }
+    }
+
+    void writeBlock(BitWriter& bits, const std::vector<Token>& tokens) {
+        std::vector<uint32_t> literalFrequencies(literalCodes, 0);
+        std::vector<uint32_t> distanceFrequencies(distanceCodes, 0);
+        for (const Token& token : tokens) {
+            if (token.distance == 0) {
+                literalFrequencies[token.value]++;
+            } else {
+                literalFrequencies[257 + findCode(lengthBase, token.value)]++;
+                distanceFrequencies[findCode(distanceBase, token.distance)]++;
+            }
+        }
+        literalFrequencies[endOfBlock]++;
+
+        HuffmanCode literals, distances;
+        literals.build(literalFrequencies, 15);
+        distances.build(distanceFrequencies, 15);
+
+        int literalCount = literalCodes;
+        while (literalCount > 257 && literals.lengths[literalCount - 1] == 0) literalCount--;
+        int distanceCount = distanceCodes;
+        while (distanceCount > 1 && distances.lengths[distanceCount - 1] == 0) distanceCount--;
+
+        // Both code lengths are stored as one sequence with the code length code
+        std::vector<uint8_t> lengths(literals.lengths.begin(), literals.lengths.begin() + literalCount);
+        lengths.insert(lengths.end(), distances.lengths.begin(), distances.lengths.begin() + distanceCount);
+        std::vector<CodeLengthSymbol> lengthSymbols;
+        encodeCodeLengths(lengths, lengthSymbols);
+
+        std::vector<uint32_t> lengthFrequencies(codeLengthCodes, 0);
+        for (const CodeLengthSymbol& symbol : lengthSymbols) lengthFrequencies[symbol.symbol]++;
+        HuffmanCode lengthCode;
+        lengthCode.build(lengthFrequencies, 7);
+        int lengthCodeCount = codeLengthCodes;
+        while (lengthCodeCount > 4 && lengthCode.lengths[codeLengthOrder[lengthCodeCount - 1]] == 0) lengthCodeCount--;
+
+        bits.put(0, 1);  // not final
+        bits.put(2, 2);  // dynamic Huffman codes
+        bits.put(uint32_t(literalCount - 257), 5);
+        bits.put(uint32_t(distanceCount - 1), 5);
+        bits.put(uint32_t(lengthCodeCount - 4), 4);
+        for (int i = 0; i < lengthCodeCount; i++) {
+            bits.put(lengthCode.lengths[codeLengthOrder[i]], 3);
+        }
+        for (const CodeLengthSymbol& symbol : lengthSymbols) {
+            lengthCode.put(bits, symbol.symbol);
+            if (symbol.symbol == 16) bits.put(symbol.extra, 2);
+            if (symbol.symbol == 17) bits.put(symbol.extra, 3);
+            if (symbol.symbol == 18) bits.put(symbol.extra, 7);
+        }
+
+        for (const Token& token : tokens) {
+            if (token.distance == 0) {
+                literals.put(bits, token.value);
+                continue;
+            }
+            int lengthIndex = findCode(lengthBase, token.value);
+            literals.put(bits, 257 + lengthIndex);
+            bits.put(token.value - lengthBase[lengthIndex], lengthExtra[lengthIndex]);
+
+            int distanceIndex = findCode(distanceBase, token.distance);
+            distances.put(bits, distanceIndex);
+            bits.put(token.distance - distanceBase[distanceIndex], distanceExtra[distanceIndex]);
+        }
+        literals.put(bits, endOfBlock);
+    }
+
+    uint32_t hashAt(const uint8_t* data) {
+        uint32_t value = uint32_t(data[0]) | uint32_t(data[1]) << 8 | uint32_t(data[2]) << 16;
+        return (value * 2654435761u) >> (32 - hashBits);
+    }
+}
+
+uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc) {
+    static const CrcTable table;
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+uint32_t adler32(const uint8_t* data, size_t size, uint32_t adler) {
+    const uint32_t modulus = 65521;
+    uint32_t a = adler & 0xFFFF;
+    uint32_t b = adler >> 16;
+    while (size > 0) {
+        // The sums cannot overflow within 5552 bytes
+        size_t count = std::min<size_t>(size, 5552);
+        for (size_t i = 0; i < count; i++) {
+            a += data[i];
+            b += a;
+        }
+        a %= modulus;
+        b %= modulus;
+        data += count;
+        size -= count;
+    }
+    return a | (b << 16);
+}
+
+uint32_t adler32Combine(uint32_t first, uint32_t second, size_t secondSize) {
+    const uint64_t modulus = 65521;
+    uint64_t remainder = secondSize % modulus;
+    uint64_t a = ((first & 0xFFFF) + (second & 0xFFFF) + modulus - 1) % modulus;
+    uint64_t b = ((first >> 16) + (second >> 16) + remainder * (first & 0xFFFF) + modulus - remainder) % modulus;
+    return uint32_t(a | (b << 16));
+}
+
+void deflatePiece(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    BitWriter bits(out);
+
+    // head holds the last position of every hash, previous the position before it with the same hash
+    const long long none = -1;
+    std::vector<long long> head(size_t(1) << hashBits, none);
+    std::vector<long long> previous(windowSize, none);
+    auto insert = [&](size_t position) {
+        uint32_t hash = hashAt(data + position);
+        previous[position % windowSize] = head[hash];
+        head[hash] = (long long)position;
+    };
+
+    std::vector<Token> tokens;
+    tokens.reserve(blockTokens);
+    size_t position = 0;
+    while (position < size) {
+        size_t bestLength = 0;
+        size_t bestDistance = 0;
+        if (position + minMatch <= size) {
+            size_t longest = std::min(maxMatch, size - position);
+            long long candidate = head[hashAt(data + position)];
+            for (int chain = 0; chain < maxChainLength && candidate != none; chain++) {
+                size_t distance = position - size_t(candidate);
+                if (distance >= windowSize) break;
+
+                const uint8_t* a = data + candidate;
+                const uint8_t* b = data + position;
+                if (a[bestLength] == b[bestLength]) {
+                    size_t length = 0;
+                    while (length < longest && a[length] == b[length]) length++;
+                    if (length > bestLength) {
+                        bestLength = length;
+                        bestDistance = distance;
+                        if (length == longest) break;
+                    }
+                }
+
+                // Slots are reused once a position leaves the window, which can link to a later position
+                long long next = previous[size_t(candidate) % windowSize];
+                if (next >= candidate) break;
+                candidate = next;
+            }
+            insert(position);
+        }
+
+        if (bestLength >= minMatch) {
+            tokens.push_back(Token{uint16_t(bestLength), uint16_t(bestDistance)});
+            for (size_t i = 1; i < bestLength; i++) {
+                if (position + i + minMatch <= size) insert(position + i);
+            }
+            position += bestLength;
+        } else {
+            tokens.push_back(Token{data[position], 0});
+            position++;
+        }
+
+        if (tokens.size() == blockTokens) {
+            writeBlock(bits, tokens);
+            tokens.clear();
+        }
+    }
+    if (!tokens.empty()) writeBlock(bits, tokens);
+
+    // An empty stored block ends the piece on a byte boundary
+    bits.put(0, 1);
+    bits.put(0, 2);
+    bits.alignToByte();
+    bits.put(0x0000, 16);
+    bits.put(0xFFFF, 16);
+}
+
+void deflateFinish(std::vector<uint8_t>& out) {
+    // Final block with fixed codes that holds only the end of block code, which is seven zero bits
+    BitWriter bits(out);
+    bits.put(1, 1);
+    bits.put(1, 2);
+    bits.put(0, 7);
+    bits.alignToByte();
+}
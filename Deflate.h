@@ -0,0 +1,26 @@
+// Deflate.h
+#ifndef DEFLATE_H
+#define DEFLATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// CRC-32 of PNG chunks, continuing from crc; start with 0
+uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+
+// Adler-32 of zlib streams, continuing from adler; start with 1
+uint32_t adler32(const uint8_t* data, size_t size, uint32_t adler = 1);
+
+// Adler-32 of two pieces of data one after the other, from the checksums of both and the size of the second
+uint32_t adler32Combine(uint32_t first, uint32_t second, size_t secondSize);
+
+// Compresses data to deflate blocks with LZ77 matches and dynamic Huffman codes. Matches stay within data
+// and no block is final; the output ends on a byte boundary. Pieces compressed separately, on any thread,
+// therefore join into one deflate stream, which deflateFinish ends.
+void deflatePiece(const uint8_t* data, size_t size, std::vector<uint8_t>& out);
+
+// Appends the empty final block of a deflate stream
+void deflateFinish(std::vector<uint8_t>& out);
+
+#endif // DEFLATE_H
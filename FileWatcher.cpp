@@ -0,0 +1,144 @@
+// FileWatcher.cpp
+#include "FileWatcher.h"
+#include <algorithm>
+#include <iostream>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    // Longest the thread waits without a change, which is also how often modification times are polled
+    // and how long stopping the watcher can take
+    const std::chrono::milliseconds idleInterval(100);
+}
+
+FileWatcher::FileWatcher(std::function<void()> onChange, double debounceSeconds)
+        : debounce(debounceSeconds), onChange(onChange), changed(false), inotifyDescriptor(-1), stopping(false) {
+#if defined(__linux__)
+    inotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+    thread = std::thread([this]() { run(); });
+}
+
+FileWatcher::~FileWatcher() {
+    stopping = true;
+    thread.join();
+#if defined(__linux__)
+    if (inotifyDescriptor >= 0) close(inotifyDescriptor);
+#endif
+}
+
+void FileWatcher::watch(const std::vector<std::string>& newFiles) {
+    std::lock_guard<std::mutex> lock(mutex);
+    files.clear();
+    for (const std::string& file : newFiles) {
+        if (!file.empty() && std::find(files.begin(), files.end(), file) == files.end()) files.push_back(file);
+    }
+
+#if defined(__linux__)
+    if (inotifyDescriptor >= 0) {
+        for (const auto& watched : watchedNames) {
+            inotify_rm_watch(inotifyDescriptor, watched.first);
+        }
+        watchedNames.clear();
+
+        // Directories are watched rather than the files, so a file saved as a new copy is still noticed
+        for (const std::string& file : files) {
+            std::filesystem::path path(file);
+            std::string directory = path.has_parent_path() ? path.parent_path().string() : ".";
+            int watch = inotify_add_watch(inotifyDescriptor, directory.c_str(),
+                                          IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+            if (watch < 0) {
+                std::cerr << "Failed to watch " << directory << " for changes to " << file << std::endl;
+                continue;
+            }
+            watchedNames[watch].insert(path.filename().string());
+        }
+        return;
+    }
+#endif
+
+    modificationTimes.clear();
+    for (const std::string& file : files) {
+        std::error_code error;
+        modificationTimes[file] = std::filesystem::last_write_time(file, error);
+    }
+}
+
+bool FileWatcher::waitForChange(std::chrono::duration<double> timeout) {
+#if defined(__linux__)
+    if (inotifyDescriptor >= 0) {
+        pollfd descriptor{inotifyDescriptor, POLLIN, 0};
+        int milliseconds = int(std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count());
+        if (poll(&descriptor, 1, std::max(0, milliseconds)) <= 0) return false;
+
+        bool any = false;
+        alignas(inotify_event) char buffer[4096];
+        ssize_t length;
+        while ((length = read(inotifyDescriptor, buffer, sizeof(buffer))) > 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (char* position = buffer; position < buffer + length;) {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(position);
+                auto watched = watchedNames.find(event->wd);
+                if (event->len > 0 && watched != watchedNames.end() && watched->second.count(event->name) > 0) {
+                    any = true;
+                }
+                position += sizeof(inotify_event) + event->len;
+            }
+        }
+        return any;
+    }
+#endif
+
+    std::this_thread::sleep_for(std::min<std::chrono::duration<double>>(timeout, idleInterval));
+    std::lock_guard<std::mutex> lock(mutex);
+    bool any = false;
+    for (auto& entry : modificationTimes) {
+        std::error_code error;
+        std::filesystem::file_time_type time = std::filesystem::last_write_time(entry.first, error);
+        if (!error && time != entry.second) {
+            entry.second = time;
+            any = true;
+        }
+    }
+    return any;
+}
+
+void FileWatcher::run() {
+    bool pending = false;
+    Clock::time_point firstChange, lastChange;
+    while (!stopping) {
+        std::chrono::duration<double> timeout = idleInterval;
+        if (pending) {
+            std::chrono::duration<double> quiet = Clock::now() - lastChange;
+            timeout = std::max(std::chrono::duration<double>(0), debounce - quiet);
+        }
+        if (waitForChange(timeout)) {
+            lastChange = Clock::now();
+            if (!pending) firstChange = lastChange;
+            pending = true;
+            continue;
+        }
+
+        if (pending && Clock::now() - lastChange >= debounce) {
+            pending = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                changed = true;
+                changeTime = firstChange;
+            }
+            onChange();
+        }
+    }
+}
+
+bool FileWatcher::takeChange(Clock::time_point& editTime) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!changed) return false;
+    changed = false;
+    editTime = changeTime;
+    return true;
+}
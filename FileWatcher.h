@@ -0,0 +1,61 @@
+// FileWatcher.h
+#ifndef FILEWATCHER_H
+#define FILEWATCHER_H
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Watches a few files from a thread of its own and reports once they stop changing. Editors write a file in
+// several steps, or save a new copy and rename it over the old one, so every change restarts a short quiet
+// period and only its end counts. On Linux the directories of the files are watched with inotify, which
+// also notices files that are replaced; elsewhere modification times are polled.
+class FileWatcher {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+private:
+    std::chrono::duration<double> debounce;
+    std::function<void()> onChange;
+
+    std::mutex mutex;
+    std::vector<std::string> files;
+    bool changed;
+    Clock::time_point changeTime;
+
+    // inotify watches and the file names of each watched directory, or the last seen modification times
+    int inotifyDescriptor;
+    std::map<int, std::set<std::string>> watchedNames;
+    std::map<std::string, std::filesystem::file_time_type> modificationTimes;
+
+    std::atomic<bool> stopping;
+    std::thread thread;
+
+    void run();
+
+    // Blocks for at most timeout; returns whether a watched file changed meanwhile
+    bool waitForChange(std::chrono::duration<double> timeout);
+
+public:
+    // onChange is called from the watcher thread once a change has settled
+    explicit FileWatcher(std::function<void()> onChange, double debounceSeconds = 0.15);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // Watches files instead of the files watched so far; empty names are left out
+    void watch(const std::vector<std::string>& files);
+
+    // Hands over a settled change once, with the time its first write was noticed
+    bool takeChange(Clock::time_point& editTime);
+};
+
+#endif // FILEWATCHER_H
@@ -0,0 +1,98 @@
+// GLHandle.h
+#ifndef GLHANDLE_H
+#define GLHANDLE_H
+
+#include <OpenGL/gl3.h>
+
+struct GLBufferTraits {
+    static GLuint create() {
+        GLuint name;
+        glGenBuffers(1, &name);
+        return name;
+    }
+    static void destroy(GLuint name) {
+        glDeleteBuffers(1, &name);
+    }
+};
+
+struct GLVertexArrayTraits {
+    static GLuint create() {
+        GLuint name;
+        glGenVertexArrays(1, &name);
+        return name;
+    }
+    static void destroy(GLuint name) {
+        glDeleteVertexArrays(1, &name);
+    }
+};
+
+struct GLProgramTraits {
+    static GLuint create() {
+        return glCreateProgram();
+    }
+    static void destroy(GLuint name) {
+        glDeleteProgram(name);
+    }
+};
+
+// Owns one GL object and deletes it when destroyed. Move-only, so a copy can never delete
+// an object that another handle still uses; 0 means no object.
+template <typename Traits>
+class GLHandle {
+private:
+    GLuint name;
+
+public:
+    GLHandle()
+            : name(0) {
+    }
+
+    // Takes ownership of an existing object
+    explicit GLHandle(GLuint name)
+            : name(name) {
+    }
+
+    ~GLHandle() {
+        reset();
+    }
+
+    GLHandle(const GLHandle&) = delete;
+    GLHandle& operator=(const GLHandle&) = delete;
+
+    GLHandle(GLHandle&& other) noexcept
+            : name(other.name) {
+        other.name = 0;
+    }
+
+    GLHandle& operator=(GLHandle&& other) noexcept {
+        if (this != &other) {
+            reset(other.name);
+            other.name = 0;
+        }
+        return *this;
+    }
+
+    static GLHandle create() {
+        return GLHandle(Traits::create());
+    }
+
+    GLuint get() const {
+        return name;
+    }
+
+    explicit operator bool() const {
+        return name != 0;
+    }
+
+    // Deletes the owned object, if any, and takes ownership of newName
+    void reset(GLuint newName = 0) {
+        if (name != 0) Traits::destroy(name);
+        name = newName;
+    }
+};
+
+typedef GLHandle<GLBufferTraits> GLBuffer;
+typedef GLHandle<GLVertexArrayTraits> GLVertexArray;
+typedef GLHandle<GLProgramTraits> GLProgram;
+
+#endif // GLHANDLE_H
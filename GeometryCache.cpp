@@ -0,0 +1,329 @@
+// GeometryCache.cpp
+#include "GeometryCache.h"
+#include "ContentHash.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+
+namespace {
+    // Pyramid files start with this header, followed by the palette, one record per level and, each on
+    // its own page, the vertices, chunks and hierarchy nodes of every level
+    struct PyramidHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        float bounds[4];
+        uint32_t paletteSize;
+        uint32_t levelCount;
+    };
+
+    // Offsets are in bytes from the start of the file, counts in elements
+    struct LevelRecord {
+        float tolerance;
+        uint32_t reserved;
+        uint64_t vertexOffset, vertexCount;
+        uint64_t chunkOffset, chunkCount;
+        uint64_t nodeOffset, nodeCount;
+    };
+
+    const char pyramidMagic[4] = {'M', 'W', 'G', 'C'};
+
+    // Raised whenever the layout of the file or of the structures stored in it changes
+    const uint32_t pyramidVersion = 1;
+    const uint64_t sectionAlignment = 4096;
+
+    // Tells apart the temporary files of the stores in progress in this process
+    std::atomic<uint64_t> temporaryFileCount(0);
+
+    static_assert(std::is_trivially_copyable<PackedVertex>::value, "PackedVertex is stored as raw bytes");
+    static_assert(std::is_trivially_copyable<SegmentChunk>::value, "SegmentChunk is stored as raw bytes");
+    static_assert(std::is_trivially_copyable<SegmentBVH::Node>::value, "SegmentBVH::Node is stored as raw bytes");
+
+    uint64_t alignSection(uint64_t offset) {
+        return (offset + sectionAlignment - 1) / sectionAlignment * sectionAlignment;
+    }
+
+    // True when count elements of elementSize bytes at offset are aligned and lie within the file
+    bool sectionFits(uint64_t offset, uint64_t count, uint64_t elementSize, size_t fileSize) {
+        return offset % sectionAlignment == 0 && offset <= fileSize && count <= (fileSize - offset) / elementSize;
+    }
+
+    // Copies the small per-level metadata out of the mapping and checks that it cannot index past the vertices
+    bool readHierarchy(const MappedFile& file, const LevelRecord& record, SegmentBVH& bvh) {
+        std::vector<SegmentChunk> chunks(record.chunkCount);
+        std::vector<SegmentBVH::Node> nodes(record.nodeCount);
+        std::memcpy(chunks.data(), file.getData() + record.chunkOffset, chunks.size() * sizeof(SegmentChunk));
+        std::memcpy(nodes.data(), file.getData() + record.nodeOffset, nodes.size() * sizeof(SegmentBVH::Node));
+
+        uint64_t segmentCount = record.vertexCount / 2;
+        for (const SegmentChunk& chunk : chunks) {
+            if (chunk.firstSegment < 0 || chunk.segmentCount < 0
+                || uint64_t(chunk.firstSegment) + uint64_t(chunk.segmentCount) > segmentCount) {
+                return false;
+            }
+        }
+        // Children come after their parent, so depths are final once a node is reached in order
+        std::vector<int> depths(nodes.size(), 0);
+        for (size_t n = 0; n < nodes.size(); n++) {
+            const SegmentBVH::Node& node = nodes[n];
+            bool leaf = node.left < 0 && node.right < 0;
+            bool children = node.left > int(n) && node.right > int(n) && size_t(node.left) < nodes.size()
+                            && size_t(node.right) < nodes.size();
+            if ((!leaf && !children) || node.firstChunk < 0 || node.chunkCount < 0
+                || uint64_t(node.firstChunk) + uint64_t(node.chunkCount) > chunks.size()) {
+                return false;
+            }
+            if (children) {
+                if (depths[n] >= SegmentBVH::maxDepth) return false;
+                depths[node.left] = std::max(depths[node.left], depths[n] + 1);
+                depths[node.right] = std::max(depths[node.right], depths[n] + 1);
+            }
+        }
+        bvh.assign(std::move(chunks), std::move(nodes));
+        return true;
+    }
+
+    void writeSection(std::ofstream& file, uint64_t offset, const void* data, size_t size) {
+        // Zeros up to the start of the section
+        static const char zeros[sectionAlignment] = {};
+        uint64_t position = uint64_t(file.tellp());
+        while (position < offset) {
+            uint64_t gap = std::min<uint64_t>(offset - position, sectionAlignment);
+            file.write(zeros, std::streamsize(gap));
+            position += gap;
+        }
+        file.write(static_cast<const char*>(data), std::streamsize(size));
+    }
+
+    std::string readText(const std::string& fileName) {
+        std::ifstream file(fileName);
+        std::ostringstream content;
+        content << file.rdbuf();
+        return content.str();
+    }
+}
+
+MappedFile::MappedFile(const unsigned char* data, size_t size)
+        : data(data), size(size) {
+}
+
+MappedFile::~MappedFile() {
+    munmap(const_cast<unsigned char*>(data), size);
+}
+
+std::shared_ptr<const MappedFile> MappedFile::open(const std::string& path) {
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) return nullptr;
+
+    struct stat status;
+    void* address = MAP_FAILED;
+    if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+        address = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    ::close(descriptor);
+    if (address == MAP_FAILED) return nullptr;
+
+    // Everything is read right away, so start paging it in before the first access
+    posix_madvise(address, size_t(status.st_size), POSIX_MADV_WILLNEED);
+    return std::shared_ptr<const MappedFile>(
+        new MappedFile(static_cast<const unsigned char*>(address), size_t(status.st_size)));
+}
+
+const unsigned char* MappedFile::getData() const {
+    return data;
+}
+
+size_t MappedFile::getSize() const {
+    return size;
+}
+
+GeometryCache::GeometryCache()
+        : requests(0), hits(0) {
+}
+
+void GeometryCache::setDirectory(const std::string& newDirectory) {
+    if (!newDirectory.empty()) {
+        std::error_code error;
+        std::filesystem::create_directories(newDirectory, error);
+        if (error) {
+            std::cerr << "Failed to create geometry cache directory " << newDirectory << ": " << error.message()
+                      << std::endl;
+            return;
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    directory = newDirectory;
+}
+
+bool GeometryCache::isEnabled() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return !directory.empty();
+}
+
+bool GeometryCache::load(uint64_t key, PreparedPyramid& pyramid) {
+    std::string path = pyramidPath(key);
+    if (path.empty()) return false;
+    requests++;
+
+    std::shared_ptr<const MappedFile> file = MappedFile::open(path);
+    if (!file || file->getSize() < sizeof(PyramidHeader)) return false;
+
+    PyramidHeader header;
+    std::memcpy(&header, file->getData(), sizeof(header));
+    if (!std::equal(pyramidMagic, pyramidMagic + 4, header.magic) || header.version != pyramidVersion
+        || header.key != key || header.paletteSize == 0 || header.paletteSize > SceneQuantizer::maxPaletteSize
+        || header.levelCount == 0 || header.levelCount > uint32_t(LodPyramid::maxLevels)) {
+        return false;
+    }
+    size_t paletteOffset = sizeof(PyramidHeader);
+    size_t recordOffset = paletteOffset + header.paletteSize * sizeof(float[3]);
+    if (recordOffset + header.levelCount * sizeof(LevelRecord) > file->getSize()) return false;
+
+    PreparedPyramid loaded;
+    loaded.quantizer.reset(Bounds(header.bounds[0], header.bounds[1], header.bounds[2], header.bounds[3]));
+    for (uint32_t i = 0; i < header.paletteSize; i++) {
+        float color[3];
+        std::memcpy(color, file->getData() + paletteOffset + i * sizeof(color), sizeof(color));
+        loaded.quantizer.addPaletteColor(glm::vec3(color[0], color[1], color[2]));
+    }
+
+    loaded.levels.resize(header.levelCount);
+    for (uint32_t k = 0; k < header.levelCount; k++) {
+        LevelRecord record;
+        std::memcpy(&record, file->getData() + recordOffset + k * sizeof(record), sizeof(record));
+        if (!sectionFits(record.vertexOffset, record.vertexCount, sizeof(PackedVertex), file->getSize())
+            || !sectionFits(record.chunkOffset, record.chunkCount, sizeof(SegmentChunk), file->getSize())
+            || !sectionFits(record.nodeOffset, record.nodeCount, sizeof(SegmentBVH::Node), file->getSize())) {
+            return false;
+        }
+
+        PreparedBatch& batch = loaded.levels[k];
+        if (!readHierarchy(*file, record, batch.bvh)) return false;
+        batch.mapping = file;
+        batch.mappedVertices = reinterpret_cast<const PackedVertex*>(file->getData() + record.vertexOffset);
+        batch.mappedVertexCount = size_t(record.vertexCount);
+        loaded.tolerances.push_back(record.tolerance);
+    }
+
+    pyramid = std::move(loaded);
+    hits++;
+    return true;
+}
+
+void GeometryCache::store(uint64_t key, const PreparedPyramid& pyramid) {
+    std::string path = pyramidPath(key);
+    if (path.empty()) return;
+
+    const Bounds& bounds = pyramid.quantizer.getBounds();
+    const std::vector<glm::vec3>& palette = pyramid.quantizer.getPalette();
+    PyramidHeader header{{pyramidMagic[0], pyramidMagic[1], pyramidMagic[2], pyramidMagic[3]},
+                         pyramidVersion, key, {bounds.minX, bounds.minY, bounds.maxX, bounds.maxY},
+                         uint32_t(palette.size()), uint32_t(pyramid.levels.size())};
+
+    // Lay out the sections first, so the records can be written before them
+    std::vector<LevelRecord> records(pyramid.levels.size());
+    uint64_t offset = sizeof(PyramidHeader) + palette.size() * sizeof(float[3]) + records.size() * sizeof(LevelRecord);
+    for (size_t k = 0; k < records.size(); k++) {
+        const PreparedBatch& batch = pyramid.levels[k];
+        LevelRecord& record = records[k];
+        record.tolerance = pyramid.tolerances[k];
+        record.reserved = 0;
+        record.vertexOffset = alignSection(offset);
+        record.vertexCount = batch.getVertexCount();
+        record.chunkOffset = alignSection(record.vertexOffset + record.vertexCount * sizeof(PackedVertex));
+        record.chunkCount = batch.bvh.getChunks().size();
+        record.nodeOffset = alignSection(record.chunkOffset + record.chunkCount * sizeof(SegmentChunk));
+        record.nodeCount = batch.bvh.getNodes().size();
+        offset = record.nodeOffset + record.nodeCount * sizeof(SegmentBVH::Node);
+    }
+
+    // Written under another name first, so other loads never map half a file. The name is unique to this
+    // process and store, since processes sharing the cache can store the same scene at once.
+    std::string temporaryPath = path + "." + std::to_string(getpid()) + "." + std::to_string(temporaryFileCount++)
+                                + ".tmp";
+    std::ofstream file(temporaryPath, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const glm::vec3& color : palette) {
+        float components[3] = {color.x, color.y, color.z};
+        file.write(reinterpret_cast<const char*>(components), sizeof(components));
+    }
+    file.write(reinterpret_cast<const char*>(records.data()), std::streamsize(records.size() * sizeof(LevelRecord)));
+    for (size_t k = 0; k < records.size() && file; k++) {
+        const PreparedBatch& batch = pyramid.levels[k];
+        const LevelRecord& record = records[k];
+        writeSection(file, record.vertexOffset, batch.getVertices(), record.vertexCount * sizeof(PackedVertex));
+        writeSection(file, record.chunkOffset, batch.bvh.getChunks().data(), record.chunkCount * sizeof(SegmentChunk));
+        writeSection(file, record.nodeOffset, batch.bvh.getNodes().data(),
+                     record.nodeCount * sizeof(SegmentBVH::Node));
+    }
+    file.close();
+    if (!file || std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to write geometry cache file " << path << std::endl;
+        std::remove(temporaryPath.c_str());
+    }
+}
+
+std::string GeometryCache::pyramidPath(uint64_t key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (directory.empty()) return std::string();
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.mwgc", (unsigned long long)key);
+    return directory + "/" + name;
+}
+
+size_t GeometryCache::getRequests() const {
+    return requests;
+}
+
+size_t GeometryCache::getHits() const {
+    return hits;
+}
+
+SceneGeometryKey sceneGeometryKey(const std::string& iniText, const ini::Configuration& conf,
+                                  float finestPixelSize) {
+    ContentHash hash('g');
+    uint32_t version = pyramidVersion;
+    hash.add(&version, sizeof(version));
+    hash.add(&finestPixelSize, sizeof(finestPixelSize));
+
+    SceneGeometryKey key;
+    key.singleColor = false;
+    key.lineColor = glm::vec3(1.0f);
+    std::string inputFile;
+    std::vector<double> color;
+    if (conf["General"]["type"].as_string_or_die() == "2DLSystem"
+        && conf["2DLSystem"]["inputfile"].as_string_if_exists(inputFile)
+        && conf["2DLSystem"]["color"].as_double_tuple_if_exists(color) && color.size() == 3) {
+        hash.add("2DLSystem");
+        hash.add(readText(inputFile));
+        key.singleColor = true;
+        key.lineColor = glm::vec3(color[0], color[1], color[2]);
+    } else {
+        hash.add(iniText);
+    }
+    key.key = hash.get();
+    return key;
+}
+
+void applyLineColor(PreparedPyramid& pyramid, const SceneGeometryKey& key) {
+    if (!key.singleColor) return;
+    pyramid.quantizer.reset(pyramid.quantizer.getBounds());
+    pyramid.quantizer.addPaletteColor(key.lineColor);
+}
+
+GeometryCache& geometryCache() {
+    static GeometryCache cache;
+    return cache;
+}
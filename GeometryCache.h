@@ -0,0 +1,86 @@
+// GeometryCache.h
+#ifndef GEOMETRYCACHE_H
+#define GEOMETRYCACHE_H
+
+#include "LevelOfDetail.h"
+#include "ini_configuration.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// A whole file mapped read-only into memory, unmapped when the last owner lets go
+class MappedFile {
+private:
+    const unsigned char* data;
+    size_t size;
+
+    MappedFile(const unsigned char* data, size_t size);
+
+public:
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // The mapped file, or nullptr when it cannot be opened or is empty
+    static std::shared_ptr<const MappedFile> open(const std::string& path);
+
+    const unsigned char* getData() const;
+    size_t getSize() const;
+};
+
+// Prepared level-of-detail pyramids stored in a directory, so a scene that was opened before skips parsing,
+// expansion, the turtle and simplification. Every file holds the quantization frame, the chunk hierarchies
+// and the packed vertices of all levels, each section aligned to a page; the vertices are mapped rather
+// than read, and go from the mapping straight into the vertex buffers. Files are versioned and checked
+// against the key, so files of another format version or another scene are ignored.
+class GeometryCache {
+private:
+    std::mutex mutex;
+    std::string directory;
+    std::atomic<size_t> requests, hits;
+
+    // Where the pyramid of key is stored; empty without a directory
+    std::string pyramidPath(uint64_t key);
+
+public:
+    GeometryCache();
+
+    GeometryCache(const GeometryCache&) = delete;
+    GeometryCache& operator=(const GeometryCache&) = delete;
+
+    // Stores pyramids in directory, which is created when missing; empty turns the cache off
+    void setDirectory(const std::string& directory);
+    bool isEnabled();
+
+    // Maps the pyramid stored for key into pyramid; false when there is none or it is damaged
+    bool load(uint64_t key, PreparedPyramid& pyramid);
+    void store(uint64_t key, const PreparedPyramid& pyramid);
+
+    size_t getRequests() const;
+    size_t getHits() const;
+};
+
+// What the prepared geometry of a scene is made from, together with the finest pixel size its levels were
+// simplified for. An L-System only depends on its L-System file and is drawn in a single line color that
+// belongs in the palette alone, so a scene that only changes color or size keeps its geometry; every
+// other scene depends on the whole INI file.
+struct SceneGeometryKey {
+    uint64_t key;
+    bool singleColor;
+    glm::vec3 lineColor;
+};
+
+SceneGeometryKey sceneGeometryKey(const std::string& iniText, const ini::Configuration& conf,
+                                  float finestPixelSize);
+
+// Replaces the palette of pyramid by the line color of key when the key leaves it out
+void applyLineColor(PreparedPyramid& pyramid, const SceneGeometryKey& key);
+
+// The cache shared by the whole program, used by the scene streamer
+GeometryCache& geometryCache();
+
+#endif // GEOMETRYCACHE_H
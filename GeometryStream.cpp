@@ -0,0 +1,115 @@
+// GeometryStream.cpp
+#include "GeometryStream.h"
+#include "LineBatch.h"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+GeometryStream::GeometryStream()
+        : VAO(GLVertexArray::create()), VBO(GLBuffer::create()), shaderProgram(createPackedLineProgram()),
+          capacity(initialCapacity), vertexCount(0), fence(nullptr) {
+    glBindVertexArray(VAO.get());
+    glBindBuffer(GL_ARRAY_BUFFER, VBO.get());
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(PackedVertex), nullptr, GL_DYNAMIC_DRAW);
+    setupPackedVertexAttributes();
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+GeometryStream::~GeometryStream() {
+    if (fence) glDeleteSync(fence);
+}
+
+void GeometryStream::reset(const Bounds& bounds) {
+    // The next appends overwrite the start of the buffer, which the last frame may still be drawing
+    if (fence) {
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    vertexCount = 0;
+    staging.clear();
+    quantizer.reset(bounds);
+}
+
+void GeometryStream::append(const LineData* lines, size_t count) {
+    if (count == 0) return;
+
+    uint8_t paletteIndex = quantizer.addPaletteColor(lines[0].color);
+    glm::vec3 lastColor = lines[0].color;
+    for (size_t i = 0; i < count; i++) {
+        const LineData& line = lines[i];
+        if (line.color != lastColor) {
+            lastColor = line.color;
+            paletteIndex = quantizer.addPaletteColor(line.color);
+        }
+        staging.push_back(quantizer.pack(line.start, paletteIndex));
+        staging.push_back(quantizer.pack(line.end, paletteIndex));
+    }
+}
+
+void GeometryStream::grow(size_t requiredVertices) {
+    size_t newCapacity = std::max(capacity * 2, requiredVertices);
+
+    // Copy on the GPU so the vertices already uploaded stay in order
+    GLBuffer newVBO = GLBuffer::create();
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newVBO.get());
+    glBufferData(GL_COPY_WRITE_BUFFER, newCapacity * sizeof(PackedVertex), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, VBO.get());
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, vertexCount * sizeof(PackedVertex));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    // Deletes the old buffer
+    VBO = std::move(newVBO);
+    capacity = newCapacity;
+
+    glBindVertexArray(VAO.get());
+    glBindBuffer(GL_ARRAY_BUFFER, VBO.get());
+    setupPackedVertexAttributes();
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void GeometryStream::flush() {
+    if (staging.empty()) return;
+
+    if (vertexCount + staging.size() > capacity) {
+        grow(vertexCount + staging.size());
+    }
+
+    // The range behind vertexCount has never been drawn, so there is nothing to synchronize with
+    glBindBuffer(GL_ARRAY_BUFFER, VBO.get());
+    void* destination = glMapBufferRange(GL_ARRAY_BUFFER, vertexCount * sizeof(PackedVertex),
+                                         staging.size() * sizeof(PackedVertex),
+                                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (destination) {
+        std::memcpy(destination, staging.data(), staging.size() * sizeof(PackedVertex));
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        vertexCount += staging.size();
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    staging.clear();
+}
+
+void GeometryStream::draw() {
+    if (vertexCount == 0) return;
+
+    glUseProgram(shaderProgram.get());
+    glBindVertexArray(VAO.get());
+    glDrawArrays(GL_LINES, 0, GLsizei(vertexCount));
+    glBindVertexArray(0);
+
+    if (fence) glDeleteSync(fence);
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+size_t GeometryStream::getSegmentCount() const {
+    return vertexCount / 2;
+}
+
+const SceneQuantizer& GeometryStream::getQuantizer() const {
+    return quantizer;
+}
@@ -0,0 +1,51 @@
+// GeometryStream.h
+#ifndef GEOMETRYSTREAM_H
+#define GEOMETRYSTREAM_H
+
+#include "GLHandle.h"
+#include "LineData.h"
+#include "PackedGeometry.h"
+#include <vector>
+
+// Append-only vertex buffer that shows a scene while it is still being generated.
+// New vertices only ever go behind the ones the GPU may be reading, so appends are mapped unsynchronized;
+// a fence after each draw protects the buffer when it is reused for the next scene.
+class GeometryStream {
+private:
+    GLVertexArray VAO;
+    GLBuffer VBO;
+    GLProgram shaderProgram;
+    size_t capacity;    // in vertices
+    size_t vertexCount;
+    GLsync fence;
+
+    SceneQuantizer quantizer;
+    std::vector<PackedVertex> staging;
+
+    void grow(size_t requiredVertices);
+
+public:
+    static const size_t initialCapacity = 1 << 20;
+
+    GeometryStream();
+    ~GeometryStream();
+
+    GeometryStream(const GeometryStream&) = delete;
+    GeometryStream& operator=(const GeometryStream&) = delete;
+
+    // Starts a new scene inside bounds, waiting until the GPU no longer reads the previous one
+    void reset(const Bounds& bounds);
+
+    // Packs lines for the next flush
+    void append(const LineData* lines, size_t count);
+
+    // Copies everything appended since the last flush into the vertex buffer
+    void flush();
+
+    void draw();
+
+    size_t getSegmentCount() const;
+    const SceneQuantizer& getQuantizer() const;
+};
+
+#endif // GEOMETRYSTREAM_H
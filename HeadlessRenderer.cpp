@@ -0,0 +1,460 @@
+// HeadlessRenderer.cpp
+#include "HeadlessRenderer.h"
+#include "BmpWriter.h"
+#include "JobSystem.h"
+#include "PngWriter.h"
+#include "QoiWriter.h"
+#include "SceneGenerator.h"
+#include "TileRasterizer.h"
+#include "l_parser.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+namespace {
+    // Coordinates and image sizes are truncated, as in the reference images
+    long toPixelCoordinate(double value) {
+        return long(std::floor(value));
+    }
+
+    double secondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Lines converted to pixel coordinates by one job
+    const size_t pixelLineGrain = 1 << 16;
+
+    PixelColor readL2DColor(const ini::Configuration& conf) {
+        return toPixelColor(conf["2DLSystem"]["color"].as_double_tuple_or_die());
+    }
+
+    // The L-System in fileName, parsed or taken from cache; nullptr when the file cannot be opened
+    std::shared_ptr<const LParser::LSystem2D> readL2DSystem(const std::string& fileName, LSystemCache* cache) {
+        if (cache) return cache->getSystem(fileName);
+        auto system = std::make_shared<LParser::LSystem2D>();
+        if (!readLSystem(fileName, *system)) return nullptr;
+        return system;
+    }
+
+    // Traces the turtle directly instead of going through the normalized single precision LineData
+    void generateL2DLines(const LParser::LSystem2D& system, const std::pmr::string& path, PixelColor color,
+                          std::vector<RasterLine>& lines) {
+        traceLSystem(system, path, [&](double x0, double y0, double x1, double y1) {
+            lines.push_back(RasterLine{x0, y0, x1, y1, color});
+            return true;
+        });
+    }
+
+    // Draws the L-System into framebuffer, which gets the size fitted to its bounds, straight from the turtle
+    void streamL2DImage(const LParser::LSystem2D& system, PixelColor color, int size, PixelColor background,
+                        bool antialiased, Framebuffer& framebuffer) {
+        LSystemSymbols symbols(system);
+
+        RasterBounds bounds;
+        traceLSystem(system, symbols, [&](double x0, double y0, double x1, double y1) {
+            bounds.add(x0, y0, x1, y1);
+            return true;
+        });
+        RasterView view = fitRasterView(bounds, size);
+        framebuffer.resize(view.width, view.height, background);
+
+        drawTraced(framebuffer, view, color, antialiased, [&](auto emit) {
+            traceLSystem(system, symbols, emit);
+        });
+    }
+
+    // Memory per pixel while drawing: the pixel, plus the coverage of sub-pixel segments when anti-aliased
+    size_t drawingBytesPerPixel(bool antialiased) {
+        return antialiased ? 3 + 4 * sizeof(float) : 3;
+    }
+
+    // Segments between two checkpoints of a banded render
+    const size_t checkpointLines = 1 << 16;
+
+    // Where the trace of a run of segments starts, and the bounds of those segments
+    struct TraceCheckpoint {
+        LSystemSymbols::iterator symbol;
+        LSystemTurtle turtle;
+        size_t lineCount;
+        RasterBounds bounds;
+    };
+
+    // Traces the runs that can touch the rows of clip again from their checkpoints, which repeats the
+    // arithmetic of the first trace exactly. Smooth lines can write rows up to margin beyond their endpoints.
+    template <typename Emit>
+    void traceBand(const std::vector<TraceCheckpoint>& checkpoints, const RasterView& view, long long margin,
+                   const PixelRect& clip, Emit emit) {
+        for (const TraceCheckpoint& checkpoint : checkpoints) {
+            long long minRow = toPixelCoordinate(checkpoint.bounds.minY * view.scaleY + view.offsetY) - margin;
+            long long maxRow = toPixelCoordinate(checkpoint.bounds.maxY * view.scaleY + view.offsetY) + margin;
+            if (checkpoint.lineCount == 0 || maxRow < clip.minY || minRow >= clip.maxY) continue;
+
+            LSystemTurtle turtle = checkpoint.turtle;
+            size_t lineCount = 0;
+            auto count = [&](double x0, double y0, double x1, double y1) {
+                lineCount++;
+                return emit(x0, y0, x1, y1);
+            };
+            for (auto symbol = checkpoint.symbol; lineCount < checkpoint.lineCount; ++symbol) {
+                turtle.step(*symbol, count);
+            }
+        }
+    }
+
+    // Renders the L-System fitted to size pixels into bmpFileName band by band. The first trace finds the
+    // bounds and saves a checkpoint every checkpointLines segments; every band then traces only the runs
+    // that reach it. One band per worker is drawn at a time, and all of them fit in memoryBudget.
+    bool renderBandedL2D(const LParser::LSystem2D& system, PixelColor color, int size, PixelColor background,
+                         bool antialiased, size_t memoryBudget, const std::string& bmpFileName,
+                         RenderTimings& timings) {
+        LSystemSymbols symbols(system);
+        LSystemTurtle turtle(system);
+        RasterBounds bounds;
+        std::vector<TraceCheckpoint> checkpoints;
+        auto measure = [&](double x0, double y0, double x1, double y1) {
+            bounds.add(x0, y0, x1, y1);
+            checkpoints.back().bounds.add(x0, y0, x1, y1);
+            checkpoints.back().lineCount++;
+            return true;
+        };
+        for (auto symbol = symbols.begin(); symbol != symbols.end(); ++symbol) {
+            if (checkpoints.empty() || checkpoints.back().lineCount == checkpointLines) {
+                checkpoints.push_back(TraceCheckpoint{symbol, turtle, 0, RasterBounds()});
+            }
+            turtle.step(*symbol, measure);
+        }
+        RasterView view = fitRasterView(bounds, size);
+
+        size_t bandCount = jobSystem().getThreadCount();
+        size_t rowBytes = size_t(view.width) * drawingBytesPerPixel(antialiased);
+        long long bandRows = (long long)std::max<size_t>(1, memoryBudget / bandCount / rowBytes);
+        std::vector<Framebuffer> bands(bandCount);
+
+        BmpWriter writer;
+        if (!writer.open(bmpFileName, view.width, view.height)) return false;
+        for (long long groupRow = 0; groupRow < view.height; groupRow += bandRows * (long long)bandCount) {
+            parallelFor(0, bandCount, 1, [&](size_t first, size_t last) {
+                for (size_t band = first; band < last; band++) {
+                    long long firstRow = groupRow + bandRows * (long long)band;
+                    int rows = int(std::max(0LL, std::min(bandRows, view.height - firstRow)));
+                    bands[band].resize(view.width, rows, background, int(firstRow));
+                    if (rows == 0) continue;
+
+                    PixelRect clip = bands[band].getBounds();
+                    drawTraced(bands[band], view, color, antialiased, [&](auto emit) {
+                        traceBand(checkpoints, view, antialiased ? 2 : 0, clip, emit);
+                    });
+                }
+            });
+
+            // Bands are written bottom up, like the rows of a BMP
+            auto encodeStart = std::chrono::steady_clock::now();
+            for (const Framebuffer& band : bands) {
+                for (int y = 0; y < band.getHeight(); y++) {
+                    writer.writeRow(band.getRow(band.getFirstRow() + y));
+                }
+            }
+            timings.encodeSeconds += secondsSince(encodeStart);
+        }
+        timings.pixelCount = size_t(view.width) * size_t(view.height);
+        return writer.close();
+    }
+
+    std::string lowercase(std::string text) {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) {
+            return char(std::tolower(c));
+        });
+        return text;
+    }
+
+    std::string lowercaseExtension(const std::string& fileName) {
+        std::string extension = std::filesystem::path(fileName).extension().string();
+        return lowercase(extension.empty() ? extension : extension.substr(1));
+    }
+}
+
+void readImageStyle(const ini::Configuration& conf, PixelColor& background, bool& antialiased) {
+    background = PixelColor{0, 0, 0};
+    std::vector<double> backgroundColor;
+    if (conf["General"]["backgroundcolor"].as_double_tuple_if_exists(backgroundColor)) {
+        background = toPixelColor(backgroundColor);
+    }
+
+    antialiased = false;
+    conf["General"]["antialiasing"].as_bool_if_exists(antialiased);
+}
+
+void RasterBounds::add(double x0, double y0, double x1, double y1) {
+    if (empty) {
+        minX = maxX = x0;
+        minY = maxY = y0;
+        empty = false;
+    }
+    minX = std::min(minX, std::min(x0, x1));
+    maxX = std::max(maxX, std::max(x0, x1));
+    minY = std::min(minY, std::min(y0, y1));
+    maxY = std::max(maxY, std::max(y0, y1));
+}
+
+bool generateRasterLines(const ini::Configuration& conf, std::vector<RasterLine>& lines, LSystemCache* cache) {
+    if (conf["General"]["type"].as_string_or_die() == "2DLSystem") {
+        std::string fileName = conf["2DLSystem"]["inputfile"].as_string_or_die();
+        std::shared_ptr<const LParser::LSystem2D> system = readL2DSystem(fileName, cache);
+        if (!system) return false;
+        if (cache) {
+            generateL2DLines(*system, *cache->getExpansion(*system), readL2DColor(conf), lines);
+        } else {
+            generateL2DLines(*system, expandLSystem(*system), readL2DColor(conf), lines);
+        }
+        return true;
+    }
+
+    std::vector<LineData> sceneLines;
+    LineCollector collector(sceneLines);
+    if (!renderScene(conf, collector)) {
+        std::cerr << "Unknown render type: " << conf["General"]["type"].as_string_or_die() << std::endl;
+        return false;
+    }
+
+    lines.reserve(lines.size() + sceneLines.size());
+    for (const LineData& line : sceneLines) {
+        lines.push_back(RasterLine{line.start.x, line.start.y, line.end.x, line.end.y, toPixelColor(line.color)});
+    }
+    return true;
+}
+
+RasterView fitRasterView(const std::vector<RasterLine>& lines, int size) {
+    RasterBounds bounds;
+    for (const RasterLine& line : lines) {
+        bounds.add(line.x0, line.y0, line.x1, line.y1);
+    }
+    return fitRasterView(bounds, size);
+}
+
+RasterView fitRasterView(const RasterBounds& bounds, int size) {
+    double minX = bounds.minX, maxX = bounds.maxX, minY = bounds.minY, maxY = bounds.maxY;
+    double rangeX = maxX - minX;
+    double rangeY = maxY - minY;
+    double range = std::max(rangeX, rangeY);
+    if (range <= 0) range = 1;
+
+    double imageX = size * rangeX / range;
+    double imageY = size * rangeY / range;
+    double scale = 0.95 * size / range;
+
+    RasterView view;
+    view.width = int(std::max(1L, toPixelCoordinate(imageX)));
+    view.height = int(std::max(1L, toPixelCoordinate(imageY)));
+    view.scaleX = scale;
+    view.scaleY = scale;
+    view.offsetX = imageX / 2 - scale * (minX + maxX) / 2;
+    view.offsetY = imageY / 2 - scale * (minY + maxY) / 2;
+    return view;
+}
+
+RasterView viewportRasterView(int width, int height) {
+    RasterView view;
+    view.width = std::max(1, width);
+    view.height = std::max(1, height);
+    view.scaleX = view.width / 2.0;
+    view.scaleY = view.height / 2.0;
+    view.offsetX = view.scaleX;
+    view.offsetY = view.scaleY;
+    return view;
+}
+
+PixelLine toPixelLine(const RasterLine& line, const RasterView& view) {
+    return PixelLine{toPixelCoordinate(line.x0 * view.scaleX + view.offsetX),
+                     toPixelCoordinate(line.y0 * view.scaleY + view.offsetY),
+                     toPixelCoordinate(line.x1 * view.scaleX + view.offsetX),
+                     toPixelCoordinate(line.y1 * view.scaleY + view.offsetY),
+                     line.color};
+}
+
+SmoothLine toSmoothLine(const RasterLine& line, const RasterView& view) {
+    return SmoothLine{float(line.x0 * view.scaleX + view.offsetX),
+                      float(line.y0 * view.scaleY + view.offsetY),
+                      float(line.x1 * view.scaleX + view.offsetX),
+                      float(line.y1 * view.scaleY + view.offsetY),
+                      line.color};
+}
+
+std::vector<PixelLine> toPixelLines(const std::vector<RasterLine>& lines, const RasterView& view) {
+    std::vector<PixelLine> pixelLines(lines.size());
+    parallelFor(0, lines.size(), pixelLineGrain, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            pixelLines[i] = toPixelLine(lines[i], view);
+        }
+    });
+    return pixelLines;
+}
+
+std::vector<SmoothLine> toSmoothLines(const std::vector<RasterLine>& lines, const RasterView& view) {
+    std::vector<SmoothLine> smoothLines(lines.size());
+    parallelFor(0, lines.size(), pixelLineGrain, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            smoothLines[i] = toSmoothLine(lines[i], view);
+        }
+    });
+    return smoothLines;
+}
+
+void rasterizeLines(const std::vector<RasterLine>& lines, const RasterView& view, Framebuffer& framebuffer,
+                    bool antialiased) {
+    if (antialiased) {
+        rasterizeTiledSmooth(framebuffer, toSmoothLines(lines, view));
+    } else {
+        std::vector<PixelLine> pixelLines = toPixelLines(lines, view);
+        removeRepeatedLines(pixelLines);
+        rasterizeTiled(framebuffer, pixelLines);
+    }
+}
+
+bool generateRasterScene(const ini::Configuration& conf, RasterScene& scene, LSystemCache* cache) {
+    readImageStyle(conf, scene.background, scene.antialiased);
+    scene.lines.clear();
+    if (!generateRasterLines(conf, scene.lines, cache)) return false;
+
+    int size;
+    if (conf["General"]["size"].as_int_if_exists(size)) {
+        scene.view = fitRasterView(scene.lines, size);
+    } else {
+        scene.view = viewportRasterView(conf["ImageProperties"]["width"].as_int_or_die(),
+                                        conf["ImageProperties"]["height"].as_int_or_die());
+    }
+    return true;
+}
+
+bool renderImage(const ini::Configuration& conf, Framebuffer& framebuffer, size_t memoryBudget,
+                 LSystemCache* cache) {
+    int size;
+    if (conf["General"]["type"].as_string_or_die() == "2DLSystem" && conf["General"]["size"].as_int_if_exists(size)) {
+        std::shared_ptr<const LParser::LSystem2D> system =
+            readL2DSystem(conf["2DLSystem"]["inputfile"].as_string_or_die(), cache);
+        if (!system) return false;
+
+        bool streamed;
+        if (!conf["General"]["streaming"].as_bool_if_exists(streamed)) {
+            streamed = countLSystemLines(*system) * storedLineBytes > double(memoryBudget);
+        }
+        if (streamed) {
+            PixelColor background;
+            bool antialiased;
+            readImageStyle(conf, background, antialiased);
+            streamL2DImage(*system, readL2DColor(conf), size, background, antialiased, framebuffer);
+            return true;
+        }
+    }
+
+    RasterScene scene;
+    if (!generateRasterScene(conf, scene, cache)) return false;
+    framebuffer.resize(scene.view.width, scene.view.height, scene.background);
+    rasterizeLines(scene.lines, scene.view, framebuffer, scene.antialiased);
+    return true;
+}
+
+bool loadConfiguration(const std::string& iniFileName, ini::Configuration& conf) {
+    std::ifstream fin(iniFileName);
+    if (fin.peek() == std::istream::traits_type::eof()) {
+        std::cout << "Ini file appears empty. Does '" << iniFileName << "' exist?" << std::endl;
+        return false;
+    }
+    fin >> conf;
+    return true;
+}
+
+bool writeImage(const std::string& fileName, const Framebuffer& framebuffer) {
+    std::string extension = lowercaseExtension(fileName);
+    if (extension == "png") return writePng(fileName, framebuffer);
+    if (extension == "qoi") return writeQoi(fileName, framebuffer);
+    return writeBmp(fileName, framebuffer);
+}
+
+bool isImageFormat(const std::string& format) {
+    std::string lower = lowercase(format);
+    return lower == "png" || lower == "qoi" || lower == "bmp";
+}
+
+std::string replaceExtension(const std::string& fileName, const std::string& extension) {
+    std::filesystem::path path(fileName);
+    path.replace_extension(extension.empty() ? extension : "." + extension);
+    return path.string();
+}
+
+std::string outputFileName(const std::string& iniFileName, const std::string& extension,
+                           const std::string& directory) {
+    std::string output = replaceExtension(iniFileName, extension);
+    if (directory.empty()) return output;
+    return (std::filesystem::path(directory) / std::filesystem::path(output).filename()).string();
+}
+
+bool renderIniToImage(const std::string& iniFileName, const std::string& imageFileName, size_t memoryBudget,
+                      RenderTimings* timings, LSystemCache* cache) {
+    if (timings) *timings = RenderTimings();
+    ini::Configuration conf;
+    try {
+        if (!loadConfiguration(iniFileName, conf)) return false;
+    }
+    catch (ini::ParseException& ex) {
+        std::cerr << "Error parsing file: " << iniFileName << ": " << ex.what() << std::endl;
+        return false;
+    }
+    return renderConfigurationToImage(conf, iniFileName, imageFileName, memoryBudget, timings, cache);
+}
+
+bool renderConfigurationToImage(const ini::Configuration& conf, const std::string& sourceName,
+                                const std::string& imageFileName, size_t memoryBudget, RenderTimings* timings,
+                                LSystemCache* cache) {
+    RenderTimings localTimings;
+    RenderTimings& times = timings ? *timings : localTimings;
+    times = RenderTimings();
+    auto start = std::chrono::steady_clock::now();
+    try {
+        // Fitted images are at most size pixels on each side
+        int size;
+        PixelColor background;
+        bool antialiased;
+        readImageStyle(conf, background, antialiased);
+        if (conf["General"]["type"].as_string_or_die() == "2DLSystem" && conf["General"]["size"].as_int_if_exists(size)
+            && double(size) * size * drawingBytesPerPixel(antialiased) > double(memoryBudget)) {
+            std::string extension = lowercaseExtension(imageFileName);
+            if (extension == "png" || extension == "qoi") {
+                std::cerr << "The image of " << sourceName << " exceeds the memory budget; "
+                          << "only BMP images can be written in bands" << std::endl;
+                return false;
+            }
+            std::shared_ptr<const LParser::LSystem2D> system =
+                readL2DSystem(conf["2DLSystem"]["inputfile"].as_string_or_die(), cache);
+            if (!system) return false;
+            bool written = renderBandedL2D(*system, readL2DColor(conf), size, background, antialiased, memoryBudget,
+                                           imageFileName, times);
+            times.renderSeconds = secondsSince(start) - times.encodeSeconds;
+            return written;
+        }
+
+        Framebuffer framebuffer;
+        if (!renderImage(conf, framebuffer, memoryBudget, cache)) return false;
+        times.renderSeconds = secondsSince(start);
+        times.pixelCount = size_t(framebuffer.getWidth()) * size_t(framebuffer.getHeight());
+
+        auto encodeStart = std::chrono::steady_clock::now();
+        bool written = writeImage(imageFileName, framebuffer);
+        times.encodeSeconds = secondsSince(encodeStart);
+        return written;
+    }
+    catch (ini::ParseException& ex) {
+        std::cerr << "Error parsing file: " << sourceName << ": " << ex.what() << std::endl;
+    }
+    catch (LParser::ParserException& ex) {
+        std::cerr << "Error parsing L-System of " << sourceName << ": " << ex.what() << std::endl;
+    }
+    catch (std::exception& ex) {
+        std::cerr << "Error rendering " << sourceName << ": " << ex.what() << std::endl;
+    }
+    return false;
+}
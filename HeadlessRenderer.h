@@ -0,0 +1,158 @@
+// HeadlessRenderer.h
+#ifndef HEADLESSRENDERER_H
+#define HEADLESSRENDERER_H
+
+#include "AntialiasedRasterizer.h"
+#include "LSystemCache.h"
+#include "LineData.h"
+#include "SoftwareRasterizer.h"
+#include "ini_configuration.h"
+#include <string>
+#include <vector>
+
+// Segment in scene coordinates. L-Systems keep the double precision of the turtle, because pixel positions
+// are truncated and single precision would move some of them.
+struct RasterLine {
+    double x0, y0, x1, y1;
+    PixelColor color;
+};
+
+// Size of an image and the mapping from scene coordinates to its pixels
+struct RasterView {
+    int width, height;
+    double scaleX, scaleY;
+    double offsetX, offsetY;
+};
+
+// Smallest rectangle around the segments added to it; all zero while empty
+struct RasterBounds {
+    double minX = 0, minY = 0, maxX = 0, maxY = 0;
+    bool empty = true;
+
+    void add(double x0, double y0, double x1, double y1);
+};
+
+// Memory a stored segment takes on the tiled path, with its raster line, pixel line and tile bin entries.
+// L-Systems whose segments would take more than the memory budget are streamed from the turtle instead.
+const double storedLineBytes = 100;
+
+// Memory for the pixels and geometry of an image that the renderers use by default
+const size_t defaultMemoryBudget = size_t(1) << 30;
+
+// Generates the scene of conf as raster lines; returns false for unknown types. L-System files and their
+// expansions are taken from cache when given one.
+bool generateRasterLines(const ini::Configuration& conf, std::vector<RasterLine>& lines,
+                         LSystemCache* cache = nullptr);
+
+// Fits lines into an image whose longest side is size pixels, with the same 5% margin and truncation
+// as the reference images
+RasterView fitRasterView(const std::vector<RasterLine>& lines, int size);
+RasterView fitRasterView(const RasterBounds& bounds, int size);
+
+// Maps the square [-1, 1] onto an image of width x height, like the OpenGL viewport does
+RasterView viewportRasterView(int width, int height);
+
+// Maps a line to pixels with truncated coordinates
+PixelLine toPixelLine(const RasterLine& line, const RasterView& view);
+
+// Maps a line to pixels keeping its sub-pixel position
+SmoothLine toSmoothLine(const RasterLine& line, const RasterView& view);
+
+// Maps lines to pixels with truncated coordinates
+std::vector<PixelLine> toPixelLines(const std::vector<RasterLine>& lines, const RasterView& view);
+
+// Maps lines to pixels keeping their sub-pixel position
+std::vector<SmoothLine> toSmoothLines(const std::vector<RasterLine>& lines, const RasterView& view);
+
+// Draws lines with the tiled rasterizer, anti-aliased or with hard edges like the reference images.
+// Hard-edged lines that repeat the one before them are skipped.
+void rasterizeLines(const std::vector<RasterLine>& lines, const RasterView& view, Framebuffer& framebuffer,
+                    bool antialiased = false);
+
+// Draws the segments trace(emit) passes to emit(x0, y0, x1, y1) into framebuffer on this thread, in order,
+// exactly like drawLines and drawSmoothLines do with stored ones. Nothing is stored per segment.
+template <typename Trace>
+void drawTraced(Framebuffer& framebuffer, const RasterView& view, PixelColor color, bool antialiased,
+                Trace trace) {
+    PixelRect clip = framebuffer.getBounds();
+    if (antialiased) {
+        CoverageAccumulator accumulator(clip);
+        trace([&](double x0, double y0, double x1, double y1) {
+            SmoothLine line = toSmoothLine(RasterLine{x0, y0, x1, y1, color}, view);
+            if (isSubPixel(line)) {
+                accumulator.splat(line);
+            } else {
+                drawSmoothLine(framebuffer, line, clip, &accumulator);
+            }
+            return true;
+        });
+        accumulator.resolveAll(framebuffer);
+    } else {
+        trace([&](double x0, double y0, double x1, double y1) {
+            drawPixelLine(framebuffer, toPixelLine(RasterLine{x0, y0, x1, y1, color}, view), clip);
+            return true;
+        });
+    }
+}
+
+// Reads General.backgroundcolor, black when missing, and General.antialiasing, off when missing
+void readImageStyle(const ini::Configuration& conf, PixelColor& background, bool& antialiased);
+
+// Everything needed to draw the scene of a config
+struct RasterScene {
+    std::vector<RasterLine> lines;
+    RasterView view;
+    PixelColor background;
+    bool antialiased;
+};
+
+// Generates the lines of conf and the view of its image, fitted to General.size or from ImageProperties;
+// returns false for unknown types
+bool generateRasterScene(const ini::Configuration& conf, RasterScene& scene, LSystemCache* cache = nullptr);
+
+// Generates the scene of conf and draws it without a window. Images with General.size are fitted to
+// their lines, the others use ImageProperties. General.antialiasing = TRUE selects anti-aliased lines.
+// Fitted L-Systems whose stored segments would not fit in memoryBudget, or with General.streaming = TRUE,
+// are traced twice without storing anything: once for their bounds and once drawing every segment as the
+// turtle emits it, on this thread. Memory then depends on the image size, not on the number of segments.
+// Returns false for unknown types.
+bool renderImage(const ini::Configuration& conf, Framebuffer& framebuffer,
+                 size_t memoryBudget = defaultMemoryBudget, LSystemCache* cache = nullptr);
+
+// Reads an ini file; returns false when it is missing or empty. Throws ini::ParseException for invalid files.
+bool loadConfiguration(const std::string& iniFileName, ini::Configuration& conf);
+
+// Writes framebuffer as a PNG, QOI or BMP image, chosen by the extension of fileName; BMP when it is none of them
+bool writeImage(const std::string& fileName, const Framebuffer& framebuffer);
+
+// Whether format is png, qoi or bmp, in any case, which writeImage writes as that format
+bool isImageFormat(const std::string& format);
+
+// fileName with the extension of its last component replaced by extension, or without it when extension is
+// empty. Dots in directory names are left alone, so v1.2/scene becomes v1.2/scene.png.
+std::string replaceExtension(const std::string& fileName, const std::string& extension);
+
+// The output named after iniFileName with extension: next to it, or in directory when that is not empty
+std::string outputFileName(const std::string& iniFileName, const std::string& extension,
+                           const std::string& directory);
+
+// Where the time of renderIniToImage went
+struct RenderTimings {
+    double renderSeconds = 0;
+    double encodeSeconds = 0;   // encoding the image and writing the file
+    size_t pixelCount = 0;
+};
+
+// Loads iniFileName and writes its image to imageFileName, in the format of its extension. Fitted L-Systems
+// whose image would not fit in memoryBudget are rendered in bands of rows that are written out as soon as they
+// are done, so BMP images can be larger than memory; the pixels are the same.
+bool renderIniToImage(const std::string& iniFileName, const std::string& imageFileName,
+                      size_t memoryBudget = defaultMemoryBudget, RenderTimings* timings = nullptr,
+                      LSystemCache* cache = nullptr);
+
+// Like renderIniToImage for a configuration that is already parsed; sourceName names it in messages
+bool renderConfigurationToImage(const ini::Configuration& conf, const std::string& sourceName,
+                                const std::string& imageFileName, size_t memoryBudget = defaultMemoryBudget,
+                                RenderTimings* timings = nullptr, LSystemCache* cache = nullptr);
+
+#endif // HEADLESSRENDERER_H
@@ -0,0 +1,190 @@
+// JobSystem.cpp
+#include "JobSystem.h"
+
+namespace {
+    // Index of the worker running on this thread, -1 on other threads
+    thread_local int workerIndex = -1;
+    thread_local JobPriority runningPriority = JobPriority::Interactive;
+
+    std::atomic<unsigned> requestedThreadCount(0);
+}
+
+JobCounter::JobCounter()
+        : pending(0) {
+}
+
+bool JobCounter::isDone() const {
+    return pending.load() == 0;
+}
+
+JobSystem::JobSystem(unsigned threadCount)
+        : queuedJobs(0), nextWorker(0), stopping(false), counterEvents(0), blockedWaiters(0) {
+    threadCount = std::max(1u, threadCount);
+    for (unsigned i = 0; i < threadCount; i++) {
+        workers.emplace_back(new Worker());
+    }
+    for (unsigned i = 0; i < threadCount; i++) {
+        threads.emplace_back(&JobSystem::workerLoop, this, int(i));
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+unsigned JobSystem::getThreadCount() const {
+    return unsigned(threads.size());
+}
+
+void JobSystem::submit(std::function<void()> fn, JobPriority priority, JobCounter* counter) {
+    if (counter) counter->pending++;
+
+    // Jobs spawned by a worker stay on its own deque until someone steals them
+    int target = workerIndex >= 0 ? workerIndex : int(nextWorker++ % workers.size());
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        queuedJobs++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(workers[target]->mutex);
+        workers[target]->queues[int(priority)].push_back(Job{std::move(fn), counter, priority});
+    }
+    wakeUp.notify_one();
+    if (counter) notifyWaiters();
+}
+
+void JobSystem::notifyWaiters() {
+    bool blocked;
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        counterEvents++;
+        blocked = blockedWaiters > 0;
+    }
+    if (blocked) counterChanged.notify_all();
+}
+
+bool JobSystem::takeFrom(Worker& worker, int priority, bool newest, const JobCounter* counter, Job& job) {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    std::deque<Job>& queue = worker.queues[priority];
+    if (queue.empty()) return false;
+
+    if (!counter) {
+        if (newest) {
+            job = std::move(queue.back());
+            queue.pop_back();
+        } else {
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+        return true;
+    }
+
+    // Waiting threads only help with their own group, so they never pick up an unrelated long job
+    if (newest) {
+        for (size_t i = queue.size(); i-- > 0;) {
+            if (queue[i].counter == counter) {
+                job = std::move(queue[i]);
+                queue.erase(queue.begin() + i);
+                return true;
+            }
+        }
+    } else {
+        for (size_t i = 0; i < queue.size(); i++) {
+            if (queue[i].counter == counter) {
+                job = std::move(queue[i]);
+                queue.erase(queue.begin() + i);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool JobSystem::takeJob(int self, const JobCounter* counter, Job& job) {
+    for (int priority = 0; priority < jobPriorityCount; priority++) {
+        if (self >= 0 && takeFrom(*workers[self], priority, true, counter, job)) {
+            queuedJobs--;
+            return true;
+        }
+        for (size_t i = 1; i <= workers.size(); i++) {
+            int victim = int((std::max(self, 0) + i) % workers.size());
+            if (victim == self) continue;
+            if (takeFrom(*workers[victim], priority, false, counter, job)) {
+                queuedJobs--;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void JobSystem::runJob(Job& job) {
+    JobPriority previous = runningPriority;
+    runningPriority = job.priority;
+    job.run();
+    runningPriority = previous;
+
+    // The counter may be gone once pending reaches 0, so only the job system is touched afterwards
+    if (job.counter) {
+        job.counter->pending--;
+        notifyWaiters();
+    }
+}
+
+void JobSystem::workerLoop(int index) {
+    workerIndex = index;
+
+    while (true) {
+        Job job;
+        if (takeJob(index, nullptr, job)) {
+            runJob(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeUp.wait(lock, [this]() { return stopping || queuedJobs > 0; });
+        if (stopping) return;
+    }
+}
+
+void JobSystem::wait(JobCounter& counter) {
+    while (!counter.isDone()) {
+        size_t seen;
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            seen = counterEvents;
+        }
+        Job job;
+        if (takeJob(workerIndex, &counter, job)) {
+            runJob(job);
+            continue;
+        }
+
+        // The remaining jobs run on other workers; sleep until one of them finishes or queues another
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        blockedWaiters++;
+        counterChanged.wait(lock, [&]() { return counterEvents != seen || counter.isDone(); });
+        blockedWaiters--;
+    }
+}
+
+void setJobThreadCount(unsigned count) {
+    requestedThreadCount = count;
+}
+
+JobSystem& jobSystem() {
+    static JobSystem system(requestedThreadCount > 0 ? requestedThreadCount.load()
+                                                     : std::max(1u, std::thread::hardware_concurrency()));
+    return system;
+}
+
+JobPriority currentJobPriority() {
+    return runningPriority;
+}
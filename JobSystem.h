@@ -0,0 +1,171 @@
+// JobSystem.h
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Workers always take interactive jobs before background ones, so a load started from the UI
+// overtakes a batch render at the next job boundary
+enum class JobPriority {
+    Interactive,
+    Background
+};
+
+const int jobPriorityCount = 2;
+
+// Number of unfinished jobs of one group
+class JobCounter {
+private:
+    std::atomic<int> pending;
+    friend class JobSystem;
+
+public:
+    JobCounter();
+
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool isDone() const;
+};
+
+// Work-stealing scheduler: every worker owns one deque per priority, takes its own newest job first
+// and steals the oldest job of another worker when it runs dry
+class JobSystem {
+private:
+    struct Job {
+        std::function<void()> run;
+        JobCounter* counter;
+        JobPriority priority;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Job> queues[jobPriorityCount];
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    std::atomic<size_t> queuedJobs;
+    std::atomic<size_t> nextWorker;
+    bool stopping;
+
+    // Counted jobs queued or finished, and the threads blocked in wait(), both guarded by sleepMutex
+    std::condition_variable counterChanged;
+    size_t counterEvents;
+    size_t blockedWaiters;
+
+    // Only jobs of counter are taken when it is given
+    bool takeJob(int self, const JobCounter* counter, Job& job);
+    bool takeFrom(Worker& worker, int priority, bool newest, const JobCounter* counter, Job& job);
+    void runJob(Job& job);
+    void notifyWaiters();
+    void workerLoop(int index);
+
+public:
+    explicit JobSystem(unsigned threadCount);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    unsigned getThreadCount() const;
+
+    // Queues fn; counter, when given, counts it as pending until it has run. fn must not throw.
+    void submit(std::function<void()> fn, JobPriority priority, JobCounter* counter = nullptr);
+
+    // Returns once every job of counter has run, running its queued jobs on this thread meanwhile
+    void wait(JobCounter& counter);
+};
+
+// Number of workers of the shared job system; only has effect before its first use. 0 picks one per core.
+void setJobThreadCount(unsigned count);
+
+// The job system shared by the whole program, started on first use
+JobSystem& jobSystem();
+
+// Priority of the job running on this thread; Interactive outside of jobs
+JobPriority currentJobPriority();
+
+// Runs body(first, last) over [begin, end) in blocks of grain elements and waits for all of them.
+// The blocks do not depend on the number of workers, so neither does the result.
+template <typename Body>
+void parallelFor(size_t begin, size_t end, size_t grain, const Body& body,
+                 JobPriority priority = currentJobPriority()) {
+    if (begin >= end) return;
+    grain = std::max<size_t>(1, grain);
+    if (end - begin <= grain) {
+        body(begin, end);
+        return;
+    }
+
+    // Hands the upper half to another worker until one block is left, on grain boundaries
+    JobSystem& system = jobSystem();
+    JobCounter counter;
+    std::function<void(size_t, size_t)> split = [&](size_t first, size_t last) {
+        while (last - first > grain) {
+            size_t blocks = (last - first + grain - 1) / grain;
+            size_t middle = first + (blocks / 2) * grain;
+            system.submit([&split, middle, last]() { split(middle, last); }, priority, &counter);
+            last = middle;
+        }
+        body(first, last);
+    };
+    split(begin, end);
+    system.wait(counter);
+}
+
+// Replaces values by their exclusive prefix combination under op, starting from identity, and returns
+// the combination of all values. op must be associative; blocks of grain elements are combined in a
+// fixed order, so floating point results do not depend on the number of workers either.
+template <typename Container, typename Op, typename T = typename Container::value_type>
+T parallelScan(Container& values, const T& identity, Op op, size_t grain,
+               JobPriority priority = currentJobPriority()) {
+    grain = std::max<size_t>(1, grain);
+    size_t blockCount = (values.size() + grain - 1) / grain;
+
+    std::vector<T> blockTotals(blockCount, identity);
+    parallelFor(0, blockCount, 1, [&](size_t first, size_t last) {
+        for (size_t block = first; block < last; block++) {
+            T total = identity;
+            size_t end = std::min(values.size(), (block + 1) * grain);
+            for (size_t i = block * grain; i < end; i++) {
+                total = op(total, values[i]);
+            }
+            blockTotals[block] = total;
+        }
+    }, priority);
+
+    T total = identity;
+    for (T& blockTotal : blockTotals) {
+        T next = op(total, blockTotal);
+        blockTotal = total;
+        total = next;
+    }
+
+    parallelFor(0, blockCount, 1, [&](size_t first, size_t last) {
+        for (size_t block = first; block < last; block++) {
+            T running = blockTotals[block];
+            size_t end = std::min(values.size(), (block + 1) * grain);
+            for (size_t i = block * grain; i < end; i++) {
+                T value = values[i];
+                values[i] = running;
+                running = op(running, value);
+            }
+        }
+    }, priority);
+    return total;
+}
+
+#endif // JOBSYSTEM_H
@@ -0,0 +1,228 @@
+// LSystemCache.cpp
+#include "LSystemCache.h"
+#include "ContentHash.h"
+#include "SceneGenerator.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+
+namespace {
+    // Expansion files start with this header, followed by the characters of the expansion
+    struct ExpansionHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        uint64_t size;
+    };
+    const char expansionMagic[4] = {'L', '2', 'D', 'X'};
+    const uint32_t expansionVersion = 1;
+
+    // The expansion depends on which symbols are rewritten, into what, from which initiator and how often
+    uint64_t expansionKey(const LParser::LSystem2D& system) {
+        ContentHash hash('x');
+        uint64_t iterations = system.get_nr_iterations();
+        hash.add(&iterations, sizeof(iterations));
+        hash.add(system.get_initiator());
+        for (char symbol : system.get_alphabet()) {
+            hash.add(&symbol, 1);
+            hash.add(system.get_replacement(symbol));
+        }
+        return hash.get();
+    }
+
+    // The expansion stored in path for key, or nullptr when there is none
+    std::shared_ptr<const std::pmr::string> readExpansionFile(const std::string& path, uint64_t key) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return nullptr;
+        ExpansionHeader header;
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+            || !std::equal(expansionMagic, expansionMagic + 4, header.magic) || header.version != expansionVersion
+            || header.key != key) {
+            return nullptr;
+        }
+
+        // A damaged header must not ask for more memory than the file holds
+        std::error_code error;
+        uintmax_t fileSize = std::filesystem::file_size(path, error);
+        if (error || fileSize < sizeof(header) || header.size != fileSize - sizeof(header)) return nullptr;
+
+        auto expansion = std::make_shared<std::pmr::string>(size_t(header.size), '\0');
+        if (!file.read(&(*expansion)[0], std::streamsize(header.size))) return nullptr;
+        return expansion;
+    }
+
+    // Tells apart the temporary files of the writes in progress in this process
+    std::atomic<uint64_t> temporaryFileCount(0);
+
+    void writeExpansionFile(const std::string& path, uint64_t key, const std::pmr::string& expansion) {
+        // Written under another name first, so other runs never read half a file. The name is unique to this
+        // process and write, since processes sharing the cache can write the same expansion at once.
+        std::string temporaryPath = path + "." + std::to_string(getpid()) + "." + std::to_string(temporaryFileCount++)
+                                    + ".tmp";
+        std::ofstream file(temporaryPath, std::ios::binary);
+        ExpansionHeader header{{expansionMagic[0], expansionMagic[1], expansionMagic[2], expansionMagic[3]},
+                               expansionVersion, key, expansion.size()};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(expansion.data(), std::streamsize(expansion.size()));
+        file.close();
+        if (!file || std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+            std::cerr << "Failed to write L-System cache file " << path << std::endl;
+            std::remove(temporaryPath.c_str());
+        }
+    }
+}
+
+LSystemCache::LSystemCache(size_t budget, const std::string& directory)
+        : usedBytes(0), budget(budget), systemRequests(0), systemLoads(0), expansionRequests(0),
+          expansionLoads(0), expansionDiskLoads(0) {
+    setDirectory(directory);
+}
+
+void LSystemCache::setDirectory(const std::string& newDirectory) {
+    if (!newDirectory.empty()) {
+        std::error_code error;
+        std::filesystem::create_directories(newDirectory, error);
+        if (error) {
+            std::cerr << "Failed to create L-System cache directory " << newDirectory << ": " << error.message()
+                      << std::endl;
+            return;
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    directory = newDirectory;
+}
+
+void LSystemCache::setBudget(size_t newBudget) {
+    std::lock_guard<std::mutex> lock(mutex);
+    budget = newBudget;
+}
+
+std::shared_ptr<LSystemCache::Entry> LSystemCache::findEntry(uint64_t key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<Entry>& entry = entries[key];
+    if (!entry) entry = std::make_shared<Entry>();
+    if (entry->listed) recentlyUsed.splice(recentlyUsed.begin(), recentlyUsed, entry->position);
+    return entry;
+}
+
+void LSystemCache::admit(uint64_t key, const std::shared_ptr<Entry>& entry, size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Entries larger than the whole budget are handed out but not kept
+    if (bytes > budget) {
+        auto found = entries.find(key);
+        if (found != entries.end() && found->second == entry) entries.erase(found);
+        return;
+    }
+
+    entry->bytes = bytes;
+    entry->listed = true;
+    entry->position = recentlyUsed.insert(recentlyUsed.begin(), key);
+    usedBytes += bytes;
+
+    // Callers that still hold a dropped entry keep its value
+    while (usedBytes > budget) {
+        auto found = entries.find(recentlyUsed.back());
+        usedBytes -= found->second->bytes;
+        entries.erase(found);
+        recentlyUsed.pop_back();
+    }
+}
+
+std::shared_ptr<const LParser::LSystem2D> LSystemCache::getSystem(const std::string& fileName, bool* cached) {
+    systemRequests++;
+    std::ifstream file(fileName);
+    if (!file) {
+        std::cerr << "Failed to open L-System file: " << fileName << std::endl;
+        return nullptr;
+    }
+    std::ostringstream content;
+    content << file.rdbuf();
+    std::string text = content.str();
+
+    ContentHash hash('f');
+    hash.add(text);
+    uint64_t key = hash.get();
+
+    // The map lock is not held while parsing, so other files load meanwhile
+    std::shared_ptr<Entry> entry = findEntry(key);
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    if (cached) *cached = entry->ready;
+    if (!entry->ready) {
+        systemLoads++;
+        std::istringstream in(text);
+        entry->system = std::make_shared<const LParser::LSystem2D>(in);
+        entry->ready = true;
+        admit(key, entry, sizeof(LParser::LSystem2D) + text.size());
+    }
+    return entry->system;
+}
+
+std::shared_ptr<const std::pmr::string> LSystemCache::getExpansion(const LParser::LSystem2D& system,
+                                                                   LoadProgress* progress, bool* cached) {
+    expansionRequests++;
+    uint64_t key = expansionKey(system);
+    std::shared_ptr<Entry> entry = findEntry(key);
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    if (cached) *cached = entry->ready;
+    if (!entry->ready) {
+        expansionLoads++;
+        std::string path = expansionPath(key);
+        if (!path.empty()) entry->expansion = readExpansionFile(path, key);
+        if (entry->expansion) {
+            expansionDiskLoads++;
+            if (cached) *cached = true;
+        } else {
+            auto expansion = std::make_shared<const std::pmr::string>(expandLSystem(system, progress));
+            if (progress && progress->isCancelled()) return expansion;
+            entry->expansion = expansion;
+            if (!path.empty()) writeExpansionFile(path, key, *expansion);
+        }
+        entry->ready = true;
+        admit(key, entry, sizeof(std::pmr::string) + entry->expansion->size());
+    }
+    return entry->expansion;
+}
+
+std::string LSystemCache::expansionPath(uint64_t key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (directory.empty()) return std::string();
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.l2dx", (unsigned long long)key);
+    return directory + "/" + name;
+}
+
+size_t LSystemCache::getSystemRequests() const {
+    return systemRequests;
+}
+
+size_t LSystemCache::getSystemLoads() const {
+    return systemLoads;
+}
+
+size_t LSystemCache::getExpansionRequests() const {
+    return expansionRequests;
+}
+
+size_t LSystemCache::getExpansionLoads() const {
+    return expansionLoads;
+}
+
+size_t LSystemCache::getExpansionDiskLoads() const {
+    return expansionDiskLoads;
+}
+
+size_t LSystemCache::getUsedBytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return usedBytes;
+}
+
+LSystemCache& lsystemCache() {
+    static LSystemCache cache;
+    return cache;
+}
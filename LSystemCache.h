@@ -0,0 +1,85 @@
+// LSystemCache.h
+#ifndef LSYSTEMCACHE_H
+#define LSYSTEMCACHE_H
+
+#include "LoadProgress.h"
+#include "l_parser.h"
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+
+// Memory the shared L-System cache keeps by default
+const size_t defaultLSystemCacheBudget = size_t(256) << 20;
+
+// Parsed L-System files and their expanded strings, addressed by content: files by a hash of their text, and
+// expansions by a hash of the rules, the initiator and the iteration count, so equal systems in different files
+// share them. Every entry is made once, by the first caller that asks for it, while callers asking for it
+// meanwhile wait. The least recently used entries are dropped once the entries take more than the budget.
+// When a directory is set, expansions are also stored there and read back by later runs.
+class LSystemCache {
+private:
+    struct Entry {
+        std::mutex mutex;
+        bool ready = false;
+        std::shared_ptr<const LParser::LSystem2D> system;
+        std::shared_ptr<const std::pmr::string> expansion;
+
+        size_t bytes = 0;
+        bool listed = false;
+        std::list<uint64_t>::iterator position;
+    };
+
+    std::mutex mutex;
+    std::map<uint64_t, std::shared_ptr<Entry>> entries;
+    std::list<uint64_t> recentlyUsed;    // most recent first
+    size_t usedBytes;
+    size_t budget;
+    std::string directory;
+
+    std::atomic<size_t> systemRequests, systemLoads;
+    std::atomic<size_t> expansionRequests, expansionLoads, expansionDiskLoads;
+
+    std::shared_ptr<Entry> findEntry(uint64_t key);
+    void admit(uint64_t key, const std::shared_ptr<Entry>& entry, size_t bytes);
+
+    // Where the expansion of key is stored; empty without a directory
+    std::string expansionPath(uint64_t key);
+
+public:
+    explicit LSystemCache(size_t budget = defaultLSystemCacheBudget, const std::string& directory = "");
+
+    LSystemCache(const LSystemCache&) = delete;
+    LSystemCache& operator=(const LSystemCache&) = delete;
+
+    // Stores expansions in directory as well, which is created when missing; empty keeps them in memory only
+    void setDirectory(const std::string& directory);
+    void setBudget(size_t budget);
+
+    // The parsed L-System file, or nullptr when it cannot be opened. The file is read on every call to find
+    // its hash. Throws LParser::ParserException for invalid files, which are tried again on the next request.
+    // cached, when given, tells whether the system was already parsed.
+    std::shared_ptr<const LParser::LSystem2D> getSystem(const std::string& fileName, bool* cached = nullptr);
+
+    // The expanded string of system. Expanding reports to progress when given one; a cancelled expansion
+    // returns an empty string and is not kept. cached, when given, tells whether it was in memory or on disk.
+    std::shared_ptr<const std::pmr::string> getExpansion(const LParser::LSystem2D& system,
+                                                         LoadProgress* progress = nullptr, bool* cached = nullptr);
+
+    // Requests so far, how many of them were not in memory, and how many of those were read from the directory
+    size_t getSystemRequests() const;
+    size_t getSystemLoads() const;
+    size_t getExpansionRequests() const;
+    size_t getExpansionLoads() const;
+    size_t getExpansionDiskLoads() const;
+    size_t getUsedBytes();
+};
+
+// The cache shared by the whole program, used by the scene generators and the headless renderers
+LSystemCache& lsystemCache();
+
+#endif // LSYSTEMCACHE_H
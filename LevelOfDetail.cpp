@@ -0,0 +1,231 @@
+// LevelOfDetail.cpp
+#include "LevelOfDetail.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+    // Squared distance from p to the segment a-b
+    float distanceToSegmentSquared(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b) {
+        float dx = b.x - a.x;
+        float dy = b.y - a.y;
+        float lengthSquared = dx * dx + dy * dy;
+        float t = 0.0f;
+        if (lengthSquared > 0.0f) {
+            t = ((p.x - a.x) * dx + (p.y - a.y) * dy) / lengthSquared;
+            t = std::max(0.0f, std::min(1.0f, t));
+        }
+        float ex = a.x + t * dx - p.x;
+        float ey = a.y + t * dy - p.y;
+        return ex * ex + ey * ey;
+    }
+
+    // Simplifies the polyline points[first..last] and appends the kept segments to out
+    void simplifyPolyline(const std::vector<glm::vec3>& points, const glm::vec3& color, float tolerance,
+                          std::vector<char>& keep, std::vector<LineData>& out, const LoadProgress* progress) {
+        size_t last = points.size() - 1;
+        keep.assign(points.size(), 0);
+        keep[0] = 1;
+        keep[last] = 1;
+
+        float toleranceSquared = tolerance * tolerance;
+        std::vector<std::pair<size_t, size_t>> stack;
+        stack.emplace_back(0, last);
+        while (!stack.empty()) {
+            if (progress && progress->isCancelled()) return;
+
+            size_t first = stack.back().first;
+            size_t end = stack.back().second;
+            stack.pop_back();
+
+            float maxDistance = 0.0f;
+            size_t split = first;
+            for (size_t i = first + 1; i < end; i++) {
+                float distance = distanceToSegmentSquared(points[i], points[first], points[end]);
+                if (distance > maxDistance) {
+                    maxDistance = distance;
+                    split = i;
+                }
+            }
+
+            if (maxDistance > toleranceSquared) {
+                keep[split] = 1;
+                stack.emplace_back(first, split);
+                stack.emplace_back(split, end);
+            }
+        }
+
+        size_t previous = 0;
+        for (size_t i = 1; i <= last; i++) {
+            if (!keep[i]) continue;
+            LineData line;
+            line.start = points[previous];
+            line.end = points[i];
+            line.color = color;
+            out.push_back(line);
+            previous = i;
+        }
+    }
+}
+
+std::vector<LineData> simplifyLines(const std::vector<LineData>& lines, float tolerance,
+                                   const LoadProgress* progress) {
+    std::vector<LineData> simplified;
+    std::vector<glm::vec3> points;
+    std::vector<char> keep;
+
+    size_t i = 0;
+    while (i < lines.size()) {
+        if (progress && progress->isCancelled()) break;
+
+        // Collect the run of segments that continue where the previous one ended
+        points.clear();
+        points.push_back(lines[i].start);
+        points.push_back(lines[i].end);
+        size_t j = i + 1;
+        while (j < lines.size() && lines[j].start == lines[j - 1].end && lines[j].color == lines[i].color) {
+            points.push_back(lines[j].end);
+            j++;
+        }
+
+        simplifyPolyline(points, lines[i].color, tolerance, keep, simplified, progress);
+        i = j;
+    }
+
+    return simplified;
+}
+
+LodPyramid::Level::Level(float tolerance, GLuint shaderProgram)
+        : tolerance(tolerance), batch(shaderProgram) {
+}
+
+LodPyramid::LodPyramid()
+        : shaderProgram(createPackedLineProgram()), levelCount(0), currentLevel(0), geometryKey(0) {
+    levels.reserve(maxLevels);
+}
+
+PreparedPyramid LodPyramid::prepare(std::vector<LineData>& lines, float finestPixelSize,
+                                    const LoadProgress* progress) {
+    PreparedPyramid pyramid;
+    pyramid.quantizer.build(lines);
+    if (lines.empty()) {
+        pyramid.tolerances.push_back(0.0f);
+        pyramid.levels.push_back(PreparedBatch());
+        return pyramid;
+    }
+
+    // Every candidate is simplified from the last level kept with the tolerance left over from it, so each
+    // level stays within its own tolerance of the original while only the kept levels are held in memory.
+    // A level is kept when it removes at least a quarter of the segments of the previous one.
+    std::vector<std::vector<LineData>> coarser;
+    coarser.reserve(maxLevels - 1);
+    std::vector<std::vector<LineData>*> kept;
+    kept.push_back(&lines);
+    pyramid.tolerances.push_back(0.0f);
+    for (int k = 1; k < maxLevels; k++) {
+        float tolerance = 0.5f * finestPixelSize * std::pow(2.0f, float(k - 1));
+        std::vector<LineData> level = simplifyLines(*kept.back(), tolerance - pyramid.tolerances.back(), progress);
+        if (progress && progress->isCancelled()) return pyramid;
+        if (level.size() * 4 > kept.back()->size() * 3) continue;
+
+        pyramid.tolerances.push_back(tolerance);
+        coarser.push_back(std::move(level));
+        kept.push_back(&coarser.back());
+    }
+
+    pyramid.levels.resize(kept.size());
+    parallelFor(0, kept.size(), 1, [&](size_t first, size_t last) {
+        for (size_t k = first; k < last; k++) {
+            pyramid.levels[k] = LineBatch::prepare(*kept[k], pyramid.quantizer);
+        }
+    });
+    return pyramid;
+}
+
+void LodPyramid::upload(PreparedPyramid&& pyramid) {
+    // The same geometry in other colors keeps its buffers
+    if (pyramid.levels.empty() && pyramid.geometryKey != 0 && pyramid.geometryKey == geometryKey) {
+        if (!pyramid.quantizer.getPalette().empty()) {
+            quantizer.reset(quantizer.getBounds());
+            for (const glm::vec3& color : pyramid.quantizer.getPalette()) quantizer.addPaletteColor(color);
+        }
+        return;
+    }
+
+    clear();
+    quantizer = pyramid.quantizer;
+    geometryKey = pyramid.geometryKey;
+
+    levelCount = pyramid.levels.size();
+    while (levels.size() < levelCount) {
+        levels.emplace_back(0.0f, shaderProgram.get());
+    }
+    for (size_t k = 0; k < levelCount; k++) {
+        levels[k].tolerance = pyramid.tolerances[k];
+        levels[k].batch.upload(std::move(pyramid.levels[k]));
+    }
+}
+
+void LodPyramid::build(std::vector<LineData>& lines, float finestPixelSize) {
+    upload(prepare(lines, finestPixelSize));
+}
+
+void LodPyramid::clear() {
+    for (size_t k = 0; k < levelCount; k++) {
+        levels[k].batch.clear();
+    }
+    levelCount = 0;
+    currentLevel = 0;
+    geometryKey = 0;
+}
+
+void LodPyramid::draw(const Bounds& view, float pixelSize) {
+    if (levelCount == 0) return;
+
+    // Coarsest level whose error is still below half a pixel
+    currentLevel = 0;
+    for (size_t k = 1; k < levelCount; k++) {
+        if (levels[k].tolerance <= 0.5f * pixelSize) {
+            currentLevel = k;
+        }
+    }
+
+    levels[currentLevel].batch.draw(view);
+}
+
+const SceneQuantizer& LodPyramid::getQuantizer() const {
+    return quantizer;
+}
+
+uint64_t LodPyramid::getGeometryKey() const {
+    return geometryKey;
+}
+
+size_t LodPyramid::getLevelCount() const {
+    return levelCount;
+}
+
+size_t LodPyramid::getCurrentLevel() const {
+    return currentLevel;
+}
+
+size_t LodPyramid::getSegmentCount() const {
+    return levelCount == 0 ? 0 : levels[0].batch.getSegmentCount();
+}
+
+size_t LodPyramid::getLevelSegmentCount() const {
+    return levelCount == 0 ? 0 : levels[currentLevel].batch.getSegmentCount();
+}
+
+size_t LodPyramid::getVisibleSegmentCount() const {
+    return levelCount == 0 ? 0 : levels[currentLevel].batch.getVisibleSegmentCount();
+}
+
+size_t LodPyramid::getChunkCount() const {
+    return levelCount == 0 ? 0 : levels[currentLevel].batch.getChunkCount();
+}
+
+size_t LodPyramid::getDrawRangeCount() const {
+    return levelCount == 0 ? 0 : levels[currentLevel].batch.getDrawRangeCount();
+}
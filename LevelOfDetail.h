@@ -0,0 +1,79 @@
+// LevelOfDetail.h
+#ifndef LEVELOFDETAIL_H
+#define LEVELOFDETAIL_H
+
+#include "LineBatch.h"
+#include "LineData.h"
+#include "LoadProgress.h"
+#include "PackedGeometry.h"
+#include "SegmentBVH.h"
+#include <cstdint>
+#include <vector>
+
+// Douglas-Peucker simplification of every connected run of equally colored segments.
+// The simplified curve stays within tolerance of the original. Returns early once progress is cancelled.
+std::vector<LineData> simplifyLines(const std::vector<LineData>& lines, float tolerance,
+                                   const LoadProgress* progress = nullptr);
+
+// CPU side of a pyramid, built off the GL thread. geometryKey names the geometry it was made from, 0 when
+// unknown. A pyramid without levels but with the key of the uploaded one stands for that geometry again.
+struct PreparedPyramid {
+    SceneQuantizer quantizer;
+    std::vector<float> tolerances;
+    std::vector<PreparedBatch> levels;
+    uint64_t geometryKey = 0;
+};
+
+// Pyramid of increasingly simplified copies of a scene, each in its own culled batch.
+// The level drawn is the coarsest one whose error stays below half a pixel.
+// Batches are kept when a scene is replaced, so reloading reuses their GL objects.
+class LodPyramid {
+private:
+    struct Level {
+        float tolerance;
+        LineBatch batch;
+
+        Level(float tolerance, GLuint shaderProgram);
+    };
+
+    GLProgram shaderProgram;
+    std::vector<Level> levels;
+    size_t levelCount;  // levels in use; the rest wait for a scene with more levels
+    size_t currentLevel;
+    SceneQuantizer quantizer;
+    uint64_t geometryKey;
+
+public:
+    static const int maxLevels = 10;
+
+    LodPyramid();
+
+    // Simplifies the coarser levels in parallel, starting at half of finestPixelSize, and prepares every level.
+    // Does not touch GL, so it can run on a worker thread.
+    static PreparedPyramid prepare(std::vector<LineData>& lines, float finestPixelSize,
+                                   const LoadProgress* progress = nullptr);
+
+    // Uploads a prepared pyramid; must run on the GL thread. A pyramid that stands for the uploaded geometry
+    // only replaces the palette, when it has one.
+    void upload(PreparedPyramid&& pyramid);
+    void build(std::vector<LineData>& lines, float finestPixelSize);
+    void clear();
+
+    void draw(const Bounds& view, float pixelSize);
+
+    // Quantization frame shared by all levels; its dequantization matrix and palette belong in SceneUniforms
+    const SceneQuantizer& getQuantizer() const;
+
+    // Key of the uploaded geometry, 0 when unknown or empty
+    uint64_t getGeometryKey() const;
+
+    size_t getLevelCount() const;
+    size_t getCurrentLevel() const;
+    size_t getSegmentCount() const;
+    size_t getLevelSegmentCount() const;
+    size_t getVisibleSegmentCount() const;
+    size_t getChunkCount() const;
+    size_t getDrawRangeCount() const;
+};
+
+#endif // LEVELOFDETAIL_H
@@ -2,26 +2,28 @@
 #ifndef LINE_H
 #define LINE_H
 
+#include "GLHandle.h"
 #include "external/glm/glm/glm.hpp"
-#include <OpenGL/gl3.h>
 
+// Move-only: it owns its GL objects, so construct lines in place (e.g. with emplace_back)
 class Line {
 private:
     glm::vec3 startPoint;
     glm::vec3 endPoint;
     glm::vec3 color;
-    GLuint VAO, VBO;
-    GLuint shaderProgram;
-    glm::mat4 MVP;
+    GLVertexArray VAO;
+    GLBuffer VBO;
+    GLProgram shaderProgram;
 
 public:
     Line(const glm::vec3& start, const glm::vec3& end);
-    ~Line();
+
+    Line(Line&&) = default;
+    Line& operator=(Line&&) = default;
 
     void setStartPoint(const glm::vec3& start);
     void setEndPoint(const glm::vec3& end);
     void setColor(const glm::vec3& color);
-    void setMVP(const glm::mat4& mvp);
 
     glm::vec3 getStartPoint() const;
     glm::vec3 getEndPoint() const;
@@ -0,0 +1,123 @@
+// LineBatch.cpp
+#include "LineBatch.h"
+#include "SceneUniforms.h"
+#include "Shader.h"
+#include <cstddef>
+#include <utility>
+
+GLProgram createPackedLineProgram() {
+    // Create vertex shader
+    const char* vertexShaderSource = "#version 330 core\n"
+                                     SCENE_UNIFORMS_GLSL
+                                     "layout (location = 0) in vec2 aPos;\n"
+                                     "layout (location = 1) in uint aColorIndex;\n"
+                                     "flat out vec3 lineColor;\n"
+                                     "void main() {\n"
+                                     "   lineColor = palette[aColorIndex].rgb;\n"
+                                     "   gl_Position = projection * view * normalization * vec4(aPos, 0.0, 1.0);\n"
+                                     "}\0";
+
+    // Create fragment shader
+    const char* fragmentShaderSource = "#version 330 core\n"
+                                       "flat in vec3 lineColor;\n"
+                                       "out vec4 FragColor;\n"
+                                       "void main() {\n"
+                                       "   FragColor = vec4(lineColor, 1.0);\n"
+                                       "}\0";
+
+    GLProgram shaderProgram = createShaderProgram(vertexShaderSource, fragmentShaderSource);
+    bindSceneUniforms(shaderProgram.get());
+    return shaderProgram;
+}
+
+void setupPackedVertexAttributes() {
+    // Normalized int16 position and palette index per vertex
+    glVertexAttribPointer(0, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, x));
+    glEnableVertexAttribArray(0);
+    glVertexAttribIPointer(1, 1, GL_UNSIGNED_BYTE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, paletteIndex));
+    glEnableVertexAttribArray(1);
+}
+
+LineBatch::LineBatch(GLuint shaderProgram)
+        : VAO(GLVertexArray::create()), VBO(GLBuffer::create()), shaderProgram(shaderProgram),
+          segmentCount(0), visibleSegments(0) {
+    glBindVertexArray(VAO.get());
+    glBindBuffer(GL_ARRAY_BUFFER, VBO.get());
+    setupPackedVertexAttributes();
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+const PackedVertex* PreparedBatch::getVertices() const {
+    return mapping ? mappedVertices : vertices.data();
+}
+
+size_t PreparedBatch::getVertexCount() const {
+    return mapping ? mappedVertexCount : vertices.size();
+}
+
+PreparedBatch LineBatch::prepare(std::vector<LineData>& lines, const SceneQuantizer& quantizer) {
+    PreparedBatch batch;
+    batch.bvh.build(lines);
+    quantizer.packLines(lines, batch.vertices);
+    return batch;
+}
+
+void LineBatch::upload(PreparedBatch&& batch) {
+    bvh = std::move(batch.bvh);
+    segmentCount = batch.getVertexCount() / 2;
+
+    // Mapped vertices go to the driver straight from the file's pages
+    glBindBuffer(GL_ARRAY_BUFFER, VBO.get());
+    glBufferData(GL_ARRAY_BUFFER, batch.getVertexCount() * sizeof(PackedVertex), batch.getVertices(),
+                 GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void LineBatch::upload(std::vector<LineData>& lines, const SceneQuantizer& quantizer) {
+    upload(prepare(lines, quantizer));
+}
+
+void LineBatch::clear() {
+    // Drops the vertex storage but keeps the buffer object for the next upload
+    glBindBuffer(GL_ARRAY_BUFFER, VBO.get());
+    glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    bvh.clear();
+    segmentCount = 0;
+    visibleSegments = 0;
+    drawFirsts.clear();
+    drawCounts.clear();
+}
+
+void LineBatch::draw(const Bounds& view) {
+    bvh.query(view, drawFirsts, drawCounts);
+
+    visibleSegments = 0;
+    for (GLsizei count : drawCounts) {
+        visibleSegments += count / 2;
+    }
+    if (drawFirsts.empty()) return;
+
+    glUseProgram(shaderProgram);
+    glBindVertexArray(VAO.get());
+    glMultiDrawArrays(GL_LINES, drawFirsts.data(), drawCounts.data(), GLsizei(drawFirsts.size()));
+    glBindVertexArray(0);
+}
+
+size_t LineBatch::getSegmentCount() const {
+    return segmentCount;
+}
+
+size_t LineBatch::getVisibleSegmentCount() const {
+    return visibleSegments;
+}
+
+size_t LineBatch::getChunkCount() const {
+    return bvh.getChunks().size();
+}
+
+size_t LineBatch::getDrawRangeCount() const {
+    return drawFirsts.size();
+}
@@ -0,0 +1,73 @@
+// LineBatch.h
+#ifndef LINEBATCH_H
+#define LINEBATCH_H
+
+#include "GLHandle.h"
+#include "LineData.h"
+#include "PackedGeometry.h"
+#include "SegmentBVH.h"
+#include <memory>
+#include <vector>
+
+class MappedFile;
+
+// Creates the program that draws PackedVertex lines with the SceneUniforms camera and palette
+GLProgram createPackedLineProgram();
+
+// Describes PackedVertex to the bound vertex array, reading from the bound array buffer
+void setupPackedVertexAttributes();
+
+// CPU side of a batch: chunk hierarchy and packed vertices, built off the GL thread
+struct PreparedBatch {
+    SegmentBVH bvh;
+    std::vector<PackedVertex> vertices;
+
+    // Vertices read from a geometry cache file instead stay in its mapping, kept alive by the batch
+    std::shared_ptr<const MappedFile> mapping;
+    const PackedVertex* mappedVertices = nullptr;
+    size_t mappedVertexCount = 0;
+
+    // The vertices, wherever they are
+    const PackedVertex* getVertices() const;
+    size_t getVertexCount() const;
+};
+
+// Draws a whole scene of line segments from a single vertex buffer, culled per chunk against the view.
+// Move-only; the program is borrowed so batches of one scene can share it.
+class LineBatch {
+private:
+    GLVertexArray VAO;
+    GLBuffer VBO;
+    GLuint shaderProgram;
+    SegmentBVH bvh;
+    size_t segmentCount;
+
+    // Draw ranges of the last culling pass, reused between frames
+    std::vector<GLint> drawFirsts;
+    std::vector<GLsizei> drawCounts;
+    size_t visibleSegments;
+
+public:
+    // shaderProgram comes from createPackedLineProgram and must outlive the batch
+    explicit LineBatch(GLuint shaderProgram);
+
+    LineBatch(LineBatch&&) = default;
+    LineBatch& operator=(LineBatch&&) = default;
+
+    // Builds the chunk hierarchy (reordering lines) and packs the vertices; safe to call from any thread
+    static PreparedBatch prepare(std::vector<LineData>& lines, const SceneQuantizer& quantizer);
+
+    // Uploads a prepared batch into the existing vertex buffer; must run on the GL thread
+    void upload(PreparedBatch&& batch);
+    void upload(std::vector<LineData>& lines, const SceneQuantizer& quantizer);
+    void clear();
+
+    void draw(const Bounds& view);
+
+    size_t getSegmentCount() const;
+    size_t getVisibleSegmentCount() const;
+    size_t getChunkCount() const;
+    size_t getDrawRangeCount() const;
+};
+
+#endif // LINEBATCH_H
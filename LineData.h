@@ -0,0 +1,14 @@
+// LineData.h
+#ifndef LINEDATA_H
+#define LINEDATA_H
+
+#include "external/glm/glm/glm.hpp"
+
+// Structure to hold line data
+struct LineData {
+    glm::vec3 start;
+    glm::vec3 end;
+    glm::vec3 color;
+};
+
+#endif // LINEDATA_H
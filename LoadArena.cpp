@@ -0,0 +1,82 @@
+// LoadArena.cpp
+#include "LoadArena.h"
+
+namespace {
+    // The buffer grows in steps of this size
+    const size_t bufferGranularity = 1 << 20;
+}
+
+CountingResource::CountingResource(std::pmr::memory_resource* upstream)
+        : upstream(upstream), allocations(0), bytes(0) {
+}
+
+void* CountingResource::do_allocate(size_t size, size_t alignment) {
+    void* pointer = upstream->allocate(size, alignment);
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(size, std::memory_order_relaxed);
+    return pointer;
+}
+
+void CountingResource::do_deallocate(void* pointer, size_t size, size_t alignment) {
+    upstream->deallocate(pointer, size, alignment);
+}
+
+bool CountingResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+void CountingResource::resetCounts() {
+    allocations = 0;
+    bytes = 0;
+}
+
+size_t CountingResource::getAllocations() const {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+size_t CountingResource::getBytes() const {
+    return bytes.load(std::memory_order_relaxed);
+}
+
+LoadArena::LoadArena()
+        : heap(std::pmr::new_delete_resource()), bufferSize(0), bufferAllocations(0) {
+    reset();
+}
+
+std::pmr::memory_resource* LoadArena::resource() {
+    return &*used;
+}
+
+void LoadArena::reset() {
+    used.reset();
+    arena.reset();
+
+    // Everything that spilled to the heap fits in the buffer next time
+    bufferAllocations = 0;
+    if (heap.getBytes() > 0) {
+        size_t required = bufferSize + heap.getBytes();
+        bufferSize = (required + bufferGranularity - 1) / bufferGranularity * bufferGranularity;
+        buffer.reset(new char[bufferSize]);
+        bufferAllocations = 1;
+    }
+    heap.resetCounts();
+
+    if (buffer) {
+        arena.emplace(buffer.get(), bufferSize, &heap);
+    } else {
+        arena.emplace(&heap);
+    }
+    used.emplace(&*arena);
+}
+
+size_t LoadArena::getUsedBytes() const {
+    return used->getBytes();
+}
+
+size_t LoadArena::getHeapAllocations() const {
+    return heap.getAllocations() + bufferAllocations;
+}
+
+size_t LoadArena::getCapacity() const {
+    return bufferSize;
+}
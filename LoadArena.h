@@ -0,0 +1,62 @@
+// LoadArena.h
+#ifndef LOADARENA_H
+#define LOADARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+// Forwards to upstream and counts what passes through
+class CountingResource : public std::pmr::memory_resource {
+private:
+    std::pmr::memory_resource* upstream;
+    std::atomic<size_t> allocations;
+    std::atomic<size_t> bytes;
+
+protected:
+    void* do_allocate(size_t size, size_t alignment) override;
+    void do_deallocate(void* pointer, size_t size, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream);
+
+    void resetCounts();
+    size_t getAllocations() const;
+    size_t getBytes() const;
+};
+
+// Monotonic arena for everything one load allocates while generating its scene. Deallocation is a no-op
+// and reset() drops everything at once. The arena starts from a buffer that grows to fit the largest load
+// so far, so reloading a scene of the same size does not reach the heap at all.
+// Allocating is not thread-safe: only the thread running the load may allocate.
+class LoadArena {
+private:
+    CountingResource heap;
+    std::unique_ptr<char[]> buffer;
+    size_t bufferSize;
+    size_t bufferAllocations;
+
+    std::optional<std::pmr::monotonic_buffer_resource> arena;
+    std::optional<CountingResource> used;
+
+public:
+    LoadArena();
+
+    LoadArena(const LoadArena&) = delete;
+    LoadArena& operator=(const LoadArena&) = delete;
+
+    std::pmr::memory_resource* resource();
+
+    // Releases all allocations; grows the buffer first when the last load did not fit
+    void reset();
+
+    // Bytes handed out and heap allocations made since the last reset
+    size_t getUsedBytes() const;
+    size_t getHeapAllocations() const;
+    size_t getCapacity() const;
+};
+
+#endif // LOADARENA_H
@@ -0,0 +1,142 @@
+// LoadProgress.cpp
+#include "LoadProgress.h"
+#include <algorithm>
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#elif defined(__linux__)
+#include <cstdio>
+#include <unistd.h>
+#endif
+
+namespace {
+    // Memory is sampled at most this often while a stage reports progress
+    const std::chrono::milliseconds sampleInterval(10);
+}
+
+size_t currentResidentMemory() {
+#if defined(__APPLE__)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) {
+        return 0;
+    }
+    return size_t(info.resident_size);
+#elif defined(__linux__)
+    FILE* statm = std::fopen("/proc/self/statm", "r");
+    if (!statm) return 0;
+    long pages = 0;
+    long resident = 0;
+    int read = std::fscanf(statm, "%ld %ld", &pages, &resident);
+    std::fclose(statm);
+    return read == 2 ? size_t(resident) * size_t(sysconf(_SC_PAGESIZE)) : 0;
+#else
+    return 0;
+#endif
+}
+
+LoadProgress::LoadProgress()
+        : cancelRequested(false), expectedLines(0) {
+    for (Stage& stage : stages) {
+        stage.state = int(StageState::Pending);
+        stage.fraction = 0.0f;
+        stage.seconds = 0.0;
+        stage.peakMemory = 0;
+    }
+}
+
+void LoadProgress::sampleMemory(Stage& stage) {
+    size_t resident = currentResidentMemory();
+    if (resident > stage.peakMemory) {
+        stage.peakMemory = resident;
+    }
+    stage.lastSample = std::chrono::steady_clock::now();
+}
+
+void LoadProgress::begin(LoadStage stage) {
+    Stage& current = stages[int(stage)];
+    current.start = std::chrono::steady_clock::now();
+    current.fraction = 0.0f;
+    sampleMemory(current);
+    current.state = int(StageState::Running);
+}
+
+void LoadProgress::update(LoadStage stage, float fraction) {
+    Stage& current = stages[int(stage)];
+    current.fraction = std::max(0.0f, std::min(1.0f, fraction));
+
+    auto now = std::chrono::steady_clock::now();
+    current.seconds = std::chrono::duration<double>(now - current.start).count();
+    if (now - current.lastSample >= sampleInterval) {
+        sampleMemory(current);
+    }
+}
+
+void LoadProgress::finish(LoadStage stage, bool cached) {
+    Stage& current = stages[int(stage)];
+    current.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - current.start).count();
+    sampleMemory(current);
+    current.fraction = 1.0f;
+    current.state = int(cancelRequested ? StageState::Cancelled : cached ? StageState::Cached : StageState::Done);
+}
+
+void LoadProgress::skip(LoadStage stage) {
+    stages[int(stage)].state = int(StageState::Skipped);
+}
+
+void LoadProgress::failRunning() {
+    for (Stage& stage : stages) {
+        if (stage.state == int(StageState::Running)) {
+            stage.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - stage.start).count();
+            stage.state = int(StageState::Failed);
+        }
+    }
+}
+
+void LoadProgress::cancel() {
+    cancelRequested = true;
+}
+
+bool LoadProgress::isCancelled() const {
+    return cancelRequested.load();
+}
+
+void LoadProgress::setExpectedLines(size_t count) {
+    expectedLines = count;
+}
+
+size_t LoadProgress::getExpectedLines() const {
+    return expectedLines.load();
+}
+
+StageState LoadProgress::getState(LoadStage stage) const {
+    StageState state = StageState(stages[int(stage)].state.load());
+    if (state == StageState::Running && cancelRequested) {
+        return StageState::Cancelled;
+    }
+    return state;
+}
+
+float LoadProgress::getFraction(LoadStage stage) const {
+    return stages[int(stage)].fraction.load();
+}
+
+double LoadProgress::getSeconds(LoadStage stage) const {
+    return stages[int(stage)].seconds.load();
+}
+
+size_t LoadProgress::getPeakMemory(LoadStage stage) const {
+    return stages[int(stage)].peakMemory.load();
+}
+
+const char* LoadProgress::getStageName(LoadStage stage) {
+    switch (stage) {
+        case LoadStage::IniParse: return "INI parse";
+        case LoadStage::L2DParse: return "L2D parse";
+        case LoadStage::Expansion: return "Expansion";
+        case LoadStage::Turtle: return "Turtle";
+        case LoadStage::LevelOfDetail: return "Level of detail";
+        case LoadStage::Upload: return "Upload";
+    }
+    return "";
+}
@@ -0,0 +1,84 @@
+// LoadProgress.h
+#ifndef LOADPROGRESS_H
+#define LOADPROGRESS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+// Stages of loading a scene, in pipeline order
+enum class LoadStage {
+    IniParse,
+    L2DParse,
+    Expansion,
+    Turtle,
+    LevelOfDetail,
+    Upload
+};
+
+const int loadStageCount = 6;
+
+enum class StageState {
+    Pending,
+    Running,
+    Done,
+    Cached,
+    Skipped,
+    Cancelled,
+    Failed
+};
+
+// Progress, timing and peak memory of every stage of one load, shared between the worker and the UI.
+// A stage is begun and finished by the same thread; all other calls are safe from any thread.
+class LoadProgress {
+private:
+    struct Stage {
+        std::atomic<int> state;
+        std::atomic<float> fraction;
+        std::atomic<double> seconds;
+        std::atomic<size_t> peakMemory;
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::time_point lastSample;
+    };
+
+    Stage stages[loadStageCount];
+    std::atomic<bool> cancelRequested;
+    std::atomic<size_t> expectedLines;
+
+    void sampleMemory(Stage& stage);
+
+public:
+    LoadProgress();
+
+    LoadProgress(const LoadProgress&) = delete;
+    LoadProgress& operator=(const LoadProgress&) = delete;
+
+    void begin(LoadStage stage);
+    void update(LoadStage stage, float fraction);
+    // cached tells that the output of the stage was taken from a cache instead of being made again
+    void finish(LoadStage stage, bool cached = false);
+    void skip(LoadStage stage);
+
+    // Marks every running stage as failed, after an error ended the load
+    void failRunning();
+
+    // Asks the worker to stop; running stages end up Cancelled
+    void cancel();
+    bool isCancelled() const;
+
+    // Number of segments the scene will have, once the generator knows it (0 until then)
+    void setExpectedLines(size_t count);
+    size_t getExpectedLines() const;
+
+    StageState getState(LoadStage stage) const;
+    float getFraction(LoadStage stage) const;
+    double getSeconds(LoadStage stage) const;
+    size_t getPeakMemory(LoadStage stage) const;
+
+    static const char* getStageName(LoadStage stage);
+};
+
+// Resident memory of the whole process in bytes, or 0 when the platform does not tell
+size_t currentResidentMemory();
+
+#endif // LOADPROGRESS_H
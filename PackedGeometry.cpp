@@ -0,0 +1,108 @@
+// PackedGeometry.cpp
+#include "PackedGeometry.h"
+#include "external/glm/glm/gtc/matrix_transform.hpp"
+#include <algorithm>
+#include <cmath>
+
+SceneQuantizer::SceneQuantizer()
+        : centerX(0.0f), centerY(0.0f), halfWidth(1.0f), halfHeight(1.0f) {
+}
+
+void SceneQuantizer::build(const std::vector<LineData>& lines) {
+    Bounds lineBounds;
+    for (const auto& line : lines) {
+        lineBounds.expand(line.start);
+        lineBounds.expand(line.end);
+    }
+    reset(lineBounds);
+
+    glm::vec3 lastColor;
+    for (size_t i = 0; i < lines.size(); i++) {
+        if (i == 0 || lines[i].color != lastColor) {
+            lastColor = lines[i].color;
+            addPaletteColor(lastColor);
+        }
+    }
+
+    if (palette.empty()) {
+        palette.push_back(glm::vec3(1.0f, 1.0f, 1.0f));
+    }
+}
+
+void SceneQuantizer::reset(const Bounds& newBounds) {
+    bounds = newBounds.isEmpty() ? Bounds(-1.0f, -1.0f, 1.0f, 1.0f) : newBounds;
+    palette.clear();
+
+    centerX = (bounds.minX + bounds.maxX) * 0.5f;
+    centerY = (bounds.minY + bounds.maxY) * 0.5f;
+    halfWidth = std::max((bounds.maxX - bounds.minX) * 0.5f, 1e-6f);
+    halfHeight = std::max((bounds.maxY - bounds.minY) * 0.5f, 1e-6f);
+}
+
+uint8_t SceneQuantizer::addPaletteColor(const glm::vec3& color) {
+    std::vector<glm::vec3>::iterator existing = std::find(palette.begin(), palette.end(), color);
+    if (existing != palette.end()) {
+        return uint8_t(existing - palette.begin());
+    }
+    if (palette.size() < maxPaletteSize) {
+        palette.push_back(color);
+        return uint8_t(palette.size() - 1);
+    }
+    return getPaletteIndex(color);
+}
+
+uint8_t SceneQuantizer::getPaletteIndex(const glm::vec3& color) const {
+    size_t best = 0;
+    float bestDistance = -1.0f;
+    for (size_t i = 0; i < palette.size(); i++) {
+        glm::vec3 difference = palette[i] - color;
+        float distance = difference.x * difference.x + difference.y * difference.y + difference.z * difference.z;
+        if (bestDistance < 0.0f || distance < bestDistance) {
+            best = i;
+            bestDistance = distance;
+            if (distance == 0.0f) break;
+        }
+    }
+    return uint8_t(best);
+}
+
+PackedVertex SceneQuantizer::pack(const glm::vec3& position, uint8_t paletteIndex) const {
+    float x = std::max(-1.0f, std::min(1.0f, (position.x - centerX) / halfWidth));
+    float y = std::max(-1.0f, std::min(1.0f, (position.y - centerY) / halfHeight));
+
+    PackedVertex vertex;
+    vertex.x = int16_t(std::lround(x * 32767.0f));
+    vertex.y = int16_t(std::lround(y * 32767.0f));
+    vertex.paletteIndex = paletteIndex;
+    vertex.padding = 0;
+    return vertex;
+}
+
+void SceneQuantizer::packLines(const std::vector<LineData>& lines, std::vector<PackedVertex>& vertices) const {
+    vertices.reserve(vertices.size() + lines.size() * 2);
+
+    // Consecutive lines nearly always share a color, so remember the last lookup
+    glm::vec3 lastColor = palette[0];
+    uint8_t lastIndex = 0;
+    for (const auto& line : lines) {
+        if (line.color != lastColor) {
+            lastColor = line.color;
+            lastIndex = getPaletteIndex(line.color);
+        }
+        vertices.push_back(pack(line.start, lastIndex));
+        vertices.push_back(pack(line.end, lastIndex));
+    }
+}
+
+glm::mat4 SceneQuantizer::getDequantization() const {
+    glm::mat4 dequantization = glm::translate(glm::mat4(1.0f), glm::vec3(centerX, centerY, 0.0f));
+    return glm::scale(dequantization, glm::vec3(halfWidth, halfHeight, 1.0f));
+}
+
+const std::vector<glm::vec3>& SceneQuantizer::getPalette() const {
+    return palette;
+}
+
+const Bounds& SceneQuantizer::getBounds() const {
+    return bounds;
+}
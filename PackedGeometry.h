@@ -0,0 +1,55 @@
+// PackedGeometry.h
+#ifndef PACKEDGEOMETRY_H
+#define PACKEDGEOMETRY_H
+
+#include "external/glm/glm/glm.hpp"
+#include "LineData.h"
+#include "SegmentBVH.h"
+#include <cstdint>
+#include <vector>
+
+// GPU vertex: position as normalized int16 relative to the scene bounds plus a palette index (6 bytes)
+struct PackedVertex {
+    int16_t x, y;
+    uint8_t paletteIndex;
+    uint8_t padding;
+};
+
+static_assert(sizeof(PackedVertex) == 6, "PackedVertex must stay tightly packed");
+
+// Quantization frame of one scene: positions map to [-1, 1] over the scene bounds and colors to palette entries
+class SceneQuantizer {
+private:
+    Bounds bounds;
+    float centerX, centerY;
+    float halfWidth, halfHeight;
+    std::vector<glm::vec3> palette;
+
+public:
+    static const size_t maxPaletteSize = 256;
+
+    SceneQuantizer();
+
+    // Computes the bounds and collects the distinct colors of lines
+    void build(const std::vector<LineData>& lines);
+
+    // Uses fixed bounds and starts over with an empty palette, for geometry that is not known up front
+    void reset(const Bounds& bounds);
+
+    // Returns the palette entry for color; colors beyond the palette size use the nearest entry
+    uint8_t getPaletteIndex(const glm::vec3& color) const;
+
+    // Like getPaletteIndex, but adds color to the palette when it is new and there is room
+    uint8_t addPaletteColor(const glm::vec3& color);
+    PackedVertex pack(const glm::vec3& position, uint8_t paletteIndex) const;
+
+    // Appends both vertices of every line to vertices
+    void packLines(const std::vector<LineData>& lines, std::vector<PackedVertex>& vertices) const;
+
+    // Matrix taking packed positions back to scene coordinates
+    glm::mat4 getDequantization() const;
+    const std::vector<glm::vec3>& getPalette() const;
+    const Bounds& getBounds() const;
+};
+
+#endif // PACKEDGEOMETRY_H
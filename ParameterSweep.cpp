@@ -0,0 +1,185 @@
+// ParameterSweep.cpp
+#include "ParameterSweep.h"
+#include "HeadlessRenderer.h"
+#include "JobSystem.h"
+#include "SceneGenerator.h"
+#include "l_parser.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+    // Values of one frame of a sweep
+    struct SweepFrame {
+        double angle;
+        double startingAngle;
+        std::vector<double> color;
+        int size;
+    };
+
+    double secondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Parses count comma separated numbers
+    bool parseValues(const std::string& text, size_t count, std::vector<double>& values) {
+        values.clear();
+        std::istringstream in(text);
+        std::string item;
+        while (std::getline(in, item, ',')) {
+            char* end;
+            values.push_back(std::strtod(item.c_str(), &end));
+            if (item.empty() || *end != '\0') return false;
+        }
+        return values.size() == count;
+    }
+
+    double rangeValue(const SweepRange& range, int step, size_t component) {
+        double from = range.from[component];
+        double to = range.to[component];
+        return range.steps == 1 ? from : from + (to - from) * step / (range.steps - 1);
+    }
+
+    // Every combination of the values of ranges applied to base, the first range varying slowest
+    std::vector<SweepFrame> listFrames(const SweepFrame& base, const std::vector<SweepRange>& ranges) {
+        size_t frameCount = 1;
+        for (const SweepRange& range : ranges) frameCount *= size_t(range.steps);
+
+        std::vector<SweepFrame> frames(frameCount, base);
+        for (size_t index = 0; index < frameCount; index++) {
+            size_t rest = index;
+            for (size_t r = ranges.size(); r-- > 0;) {
+                const SweepRange& range = ranges[r];
+                int step = int(rest % size_t(range.steps));
+                rest /= size_t(range.steps);
+
+                SweepFrame& frame = frames[index];
+                if (range.parameter == "Angle") {
+                    frame.angle = rangeValue(range, step, 0);
+                } else if (range.parameter == "StartingAngle") {
+                    frame.startingAngle = rangeValue(range, step, 0);
+                } else if (range.parameter == "size") {
+                    frame.size = std::max(1, int(std::lround(rangeValue(range, step, 0))));
+                } else {
+                    for (size_t c = 0; c < 3; c++) frame.color[c] = rangeValue(range, step, c);
+                }
+            }
+        }
+        return frames;
+    }
+}
+
+bool parseSweepRange(const std::string& text, SweepRange& range) {
+    size_t equals = text.find('=');
+    std::string name = text.substr(0, equals);
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) {
+        return char(std::tolower(c));
+    });
+
+    size_t valueCount = 1;
+    if (name == "angle") {
+        range.parameter = "Angle";
+    } else if (name == "startingangle") {
+        range.parameter = "StartingAngle";
+    } else if (name == "size") {
+        range.parameter = "size";
+    } else if (name == "color") {
+        range.parameter = "color";
+        valueCount = 3;
+    } else {
+        std::cerr << "Unknown sweep parameter '" << name << "'; use Angle, StartingAngle, size or color" << std::endl;
+        return false;
+    }
+
+    std::vector<std::string> parts;
+    std::istringstream in(equals == std::string::npos ? std::string() : text.substr(equals + 1));
+    std::string part;
+    while (std::getline(in, part, ':')) parts.push_back(part);
+
+    char* end = nullptr;
+    range.steps = parts.size() == 3 ? int(std::strtol(parts[2].c_str(), &end, 10)) : 0;
+    if (parts.size() != 3 || *end != '\0' || range.steps < 1 || !parseValues(parts[0], valueCount, range.from)
+        || !parseValues(parts[1], valueCount, range.to)) {
+        std::cerr << "Invalid sweep '" << text << "'; expected " << range.parameter
+                  << (valueCount == 3 ? "=r,g,b:r,g,b:steps" : "=from:to:steps") << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool renderSweep(const std::string& iniFileName, const std::vector<SweepRange>& ranges, const std::string& format,
+                 LSystemCache& cache) {
+    try {
+        ini::Configuration conf;
+        if (!loadConfiguration(iniFileName, conf)) return false;
+
+        int size;
+        if (conf["General"]["type"].as_string_or_die() != "2DLSystem" || !conf["General"]["size"].as_int_if_exists(size)) {
+            std::cerr << "Only L-Systems fitted to General.size can be swept: " << iniFileName << std::endl;
+            return false;
+        }
+        std::shared_ptr<const LParser::LSystem2D> system =
+            cache.getSystem(conf["2DLSystem"]["inputfile"].as_string_or_die());
+        if (!system) return false;
+
+        PixelColor background;
+        bool antialiased;
+        readImageStyle(conf, background, antialiased);
+
+        auto start = std::chrono::steady_clock::now();
+        LSystemWalk walk(*system, *cache.getExpansion(*system));
+        double walkSeconds = secondsSince(start);
+
+        SweepFrame base{system->get_angle(), system->get_starting_angle(),
+                        conf["2DLSystem"]["color"].as_double_tuple_or_die(), size};
+        std::vector<SweepFrame> frames = listFrames(base, ranges);
+        std::string prefix = replaceExtension(iniFileName, "") + "_";
+        int digits = std::max<int>(4, int(std::to_string(frames.size() - 1).size()));
+
+        // Every frame traces the walk twice, once for its bounds and once drawing, and stores no segments
+        std::atomic<size_t> failures(0);
+        auto framesStart = std::chrono::steady_clock::now();
+        parallelFor(0, frames.size(), 1, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) {
+                const SweepFrame& frame = frames[i];
+                RasterBounds bounds;
+                walk.trace(frame.startingAngle, frame.angle, [&](double x0, double y0, double x1, double y1) {
+                    bounds.add(x0, y0, x1, y1);
+                    return true;
+                });
+                RasterView view = fitRasterView(bounds, frame.size);
+
+                Framebuffer framebuffer(view.width, view.height, background);
+                drawTraced(framebuffer, view, toPixelColor(frame.color), antialiased, [&](auto emit) {
+                    walk.trace(frame.startingAngle, frame.angle, emit);
+                });
+
+                std::ostringstream fileName;
+                fileName << prefix << std::setw(digits) << std::setfill('0') << i << "." << format;
+                if (!writeImage(fileName.str(), framebuffer)) failures++;
+            }
+        });
+        double framesSeconds = secondsSince(framesStart);
+
+        std::cout << std::fixed << std::setprecision(3) << "Swept " << iniFileName << " into " << frames.size()
+                  << " frames of " << walk.getLineCount() << " segments in " << walkSeconds + framesSeconds
+                  << " s: expansion and walk " << walkSeconds << " s, " << 1000 * framesSeconds / frames.size()
+                  << " ms per frame" << std::defaultfloat << std::endl;
+        return failures == 0;
+    }
+    catch (ini::ParseException& ex) {
+        std::cerr << "Error parsing file: " << iniFileName << ": " << ex.what() << std::endl;
+    }
+    catch (LParser::ParserException& ex) {
+        std::cerr << "Error parsing L-System of " << iniFileName << ": " << ex.what() << std::endl;
+    }
+    catch (std::exception& ex) {
+        std::cerr << "Error rendering " << iniFileName << ": " << ex.what() << std::endl;
+    }
+    return false;
+}
@@ -0,0 +1,29 @@
+// ParameterSweep.h
+#ifndef PARAMETERSWEEP_H
+#define PARAMETERSWEEP_H
+
+#include "LSystemCache.h"
+#include <string>
+#include <vector>
+
+// A parameter of a sweep and the values it steps through: Angle and StartingAngle of the L-System, or size
+// and color of the image
+struct SweepRange {
+    std::string parameter;
+    std::vector<double> from, to;    // one value each, three for color
+    int steps;
+};
+
+// Parses parameter=from:to:steps, where colors are written as r,g,b; steps values are spread evenly from
+// from to to, both included. Returns false with a message on std::cerr when text is invalid.
+bool parseSweepRange(const std::string& text, SweepRange& range);
+
+// Renders a frame of the fitted L-System in iniFileName for every combination of the values of ranges, the
+// first range varying slowest, to name_0000.format and onwards next to it. Parameters without a range keep
+// their value from the files. The L-System is expanded once, taken from cache, and walked once; every frame
+// traces that walk at its own angles and draws it straight into its image, and the frames are rendered in
+// parallel.
+bool renderSweep(const std::string& iniFileName, const std::vector<SweepRange>& ranges, const std::string& format,
+                 LSystemCache& cache);
+
+#endif // PARAMETERSWEEP_H
@@ -0,0 +1,175 @@
+// PngWriter.cpp
+#include "PngWriter.h"
+#include "Deflate.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    // Rows compressed together; smaller bands compress slightly worse, since matches cannot cross them.
+    // Fixed, so the file has the same bytes however many workers there are.
+    const size_t bandRows = 64;
+
+    // 300 dpi, as in the BMP images
+    const uint32_t pixelsPerMeter = 11811;
+
+    const size_t bytesPerPixel = 3;
+
+    void putUint32(std::vector<uint8_t>& out, uint32_t value) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            out.push_back(uint8_t(value >> shift));
+        }
+    }
+
+    // Appends a chunk whose data starts at dataStart in out, after the space reserved for length and type
+    void finishChunk(std::vector<uint8_t>& out, size_t chunkStart, const char* type) {
+        uint32_t length = uint32_t(out.size() - chunkStart - 8);
+        for (int i = 0; i < 4; i++) {
+            out[chunkStart + i] = uint8_t(length >> (24 - 8 * i));
+            out[chunkStart + 4 + i] = uint8_t(type[i]);
+        }
+        putUint32(out, crc32(out.data() + chunkStart + 4, out.size() - chunkStart - 4));
+    }
+
+    size_t startChunk(std::vector<uint8_t>& out) {
+        size_t chunkStart = out.size();
+        out.resize(out.size() + 8);
+        return chunkStart;
+    }
+
+    // Of left, up and upLeft, the one closest to left + up - upLeft
+    uint8_t paeth(int left, int up, int upLeft) {
+        int distanceLeft = std::abs(up - upLeft);
+        int distanceUp = std::abs(left - upLeft);
+        int distanceUpLeft = std::abs(left + up - 2 * upLeft);
+        int nearest = distanceUp <= distanceUpLeft ? up : upLeft;
+        return uint8_t(distanceLeft <= distanceUp && distanceLeft <= distanceUpLeft ? left : nearest);
+    }
+
+    // Filters row against predict(left, up, upLeft) into out; returns the sum of the absolute values
+    template <typename Predict>
+    uint64_t applyFilter(const uint8_t* row, const uint8_t* previous, size_t size, uint8_t* out, Predict predict) {
+        uint64_t score = 0;
+        for (size_t i = 0; i < size; i++) {
+            int left = i >= bytesPerPixel ? row[i - bytesPerPixel] : 0;
+            int upLeft = i >= bytesPerPixel ? previous[i - bytesPerPixel] : 0;
+            int8_t value = int8_t(row[i] - predict(left, int(previous[i]), upLeft));
+            out[i] = uint8_t(value);
+            score += uint32_t(value < 0 ? -value : value);
+        }
+        return score;
+    }
+
+    // Writes the filter type and the filtered bytes of row, with previous the row above it, trying all
+    // five filters
+    void filterRow(const uint8_t* row, const uint8_t* previous, size_t size, uint8_t* out,
+                   std::vector<uint8_t>& candidate) {
+        candidate.resize(size);
+        uint64_t bestScore = UINT64_MAX;
+        auto consider = [&](uint8_t filter, uint64_t score) {
+            if (score >= bestScore) return;
+            bestScore = score;
+            out[0] = filter;
+            std::copy(candidate.begin(), candidate.end(), out + 1);
+        };
+        consider(0, applyFilter(row, previous, size, candidate.data(), [](int, int, int) { return 0; }));
+        consider(1, applyFilter(row, previous, size, candidate.data(), [](int left, int, int) { return left; }));
+        consider(2, applyFilter(row, previous, size, candidate.data(), [](int, int up, int) { return up; }));
+        consider(3, applyFilter(row, previous, size, candidate.data(), [](int left, int up, int) {
+            return (left + up) / 2;
+        }));
+        consider(4, applyFilter(row, previous, size, candidate.data(), paeth));
+    }
+}
+
+std::vector<uint8_t> encodePng(const Framebuffer& framebuffer) {
+    size_t width = size_t(framebuffer.getWidth());
+    size_t height = size_t(framebuffer.getHeight());
+    size_t rowSize = width * bytesPerPixel;
+
+    // PNG rows go from the top down
+    auto topRow = [&](size_t row) {
+        return framebuffer.getRow(framebuffer.getFirstRow() + int(height - 1 - row));
+    };
+
+    size_t bandCount = std::max<size_t>(1, (height + bandRows - 1) / bandRows);
+    std::vector<std::vector<uint8_t>> bands(bandCount);
+    std::vector<uint32_t> bandAdlers(bandCount);
+    std::vector<size_t> bandSizes(bandCount);
+    parallelFor(0, bandCount, 1, [&](size_t first, size_t last) {
+        std::vector<uint8_t> filtered;
+        std::vector<uint8_t> candidate;
+        std::vector<uint8_t> zeroRow(rowSize, 0);
+        for (size_t band = first; band < last; band++) {
+            size_t rowBegin = band * bandRows;
+            size_t rowEnd = std::min(height, rowBegin + bandRows);
+
+            filtered.resize((rowEnd - rowBegin) * (rowSize + 1));
+            for (size_t row = rowBegin; row < rowEnd; row++) {
+                filterRow(topRow(row), row > 0 ? topRow(row - 1) : zeroRow.data(), rowSize,
+                          filtered.data() + (row - rowBegin) * (rowSize + 1), candidate);
+            }
+            bandAdlers[band] = adler32(filtered.data(), filtered.size());
+            bandSizes[band] = filtered.size();
+
+            // Every band is an IDAT chunk of its own, so its checksum is computed here too
+            std::vector<uint8_t>& out = bands[band];
+            size_t chunkStart = startChunk(out);
+            deflatePiece(filtered.data(), filtered.size(), out);
+            finishChunk(out, chunkStart, "IDAT");
+        }
+    });
+
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+    size_t chunkStart = startChunk(png);
+    putUint32(png, uint32_t(width));
+    putUint32(png, uint32_t(height));
+    png.push_back(8);  // bits per channel
+    png.push_back(2);  // RGB
+    png.push_back(0);  // deflate
+    png.push_back(0);  // adaptive filters
+    png.push_back(0);  // not interlaced
+    finishChunk(png, chunkStart, "IHDR");
+
+    chunkStart = startChunk(png);
+    putUint32(png, pixelsPerMeter);
+    putUint32(png, pixelsPerMeter);
+    png.push_back(1);  // meters
+    finishChunk(png, chunkStart, "pHYs");
+
+    // zlib header: deflate with a 32K window, no dictionary
+    chunkStart = startChunk(png);
+    png.push_back(0x78);
+    png.push_back(0x01);
+    finishChunk(png, chunkStart, "IDAT");
+
+    uint32_t adler = 1;
+    for (size_t band = 0; band < bandCount; band++) {
+        png.insert(png.end(), bands[band].begin(), bands[band].end());
+        std::vector<uint8_t>().swap(bands[band]);
+        adler = adler32Combine(adler, bandAdlers[band], bandSizes[band]);
+    }
+
+    chunkStart = startChunk(png);
+    deflateFinish(png);
+    putUint32(png, adler);
+    finishChunk(png, chunkStart, "IDAT");
+
+    chunkStart = startChunk(png);
+    finishChunk(png, chunkStart, "IEND");
+    return png;
+}
+
+bool writePng(const std::string& fileName, const Framebuffer& framebuffer) {
+    std::vector<uint8_t> png = encodePng(framebuffer);
+    std::ofstream out(fileName, std::ios::binary);
+    if (!out) {
+        std::cerr << "Failed to create image file: " << fileName << std::endl;
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(png.data()), png.size());
+    return bool(out);
+}
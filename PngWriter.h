@@ -0,0 +1,18 @@
+// PngWriter.h
+#ifndef PNGWRITER_H
+#define PNGWRITER_H
+
+#include "SoftwareRasterizer.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Encodes framebuffer as an 8-bit RGB PNG. Bands of a fixed number of rows are filtered and compressed in
+// parallel into independent deflate pieces, each stored in its own IDAT chunk, so the bytes do not depend
+// on the number of workers. Every row gets the filter whose output
+// has the smallest sum of absolute values, which predicts best how well it compresses.
+std::vector<uint8_t> encodePng(const Framebuffer& framebuffer);
+
+bool writePng(const std::string& fileName, const Framebuffer& framebuffer);
+
+#endif // PNGWRITER_H
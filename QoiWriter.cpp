@@ -0,0 +1,112 @@
+// QoiWriter.cpp
+#include "QoiWriter.h"
+#include <fstream>
+#include <iostream>
+
+namespace {
+    const uint8_t opIndex = 0x00;
+    const uint8_t opDiff = 0x40;
+    const uint8_t opLuma = 0x80;
+    const uint8_t opRun = 0xC0;
+    const uint8_t opRgb = 0xFE;
+
+    // Longest run a single opRun can hold
+    const int maxRun = 62;
+
+    // Slot of a color in the index of previously seen pixels; all pixels have alpha 255
+    int colorHash(const PixelColor& color) {
+        return (color.r * 3 + color.g * 5 + color.b * 7 + 255 * 11) % 64;
+    }
+
+    void putUint32(std::vector<uint8_t>& out, uint32_t value) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            out.push_back(uint8_t(value >> shift));
+        }
+    }
+}
+
+std::vector<uint8_t> encodeQoi(const Framebuffer& framebuffer) {
+    int width = framebuffer.getWidth();
+    int height = framebuffer.getHeight();
+
+    std::vector<uint8_t> qoi = {'q', 'o', 'i', 'f'};
+    putUint32(qoi, uint32_t(width));
+    putUint32(qoi, uint32_t(height));
+    qoi.push_back(3);  // RGB
+    qoi.push_back(0);  // sRGB
+    qoi.reserve(qoi.size() + size_t(width) * height / 4);
+
+    // Pixels seen before by the hash of their color
+    PixelColor seen[64] = {};
+    bool seenValid[64] = {};
+    PixelColor previous{0, 0, 0};
+    int run = 0;
+
+    // QOI rows go from the top down
+    for (int row = height - 1; row >= 0; row--) {
+        const uint8_t* pixels = framebuffer.getRow(framebuffer.getFirstRow() + row);
+        for (int x = 0; x < width; x++) {
+            PixelColor pixel{pixels[x * 3], pixels[x * 3 + 1], pixels[x * 3 + 2]};
+            if (pixel.r == previous.r && pixel.g == previous.g && pixel.b == previous.b) {
+                // Decoders put the pixel of a run in the index too, which matters for the initial black
+                if (run == 0) {
+                    int hash = colorHash(pixel);
+                    seen[hash] = pixel;
+                    seenValid[hash] = true;
+                }
+                if (++run == maxRun) {
+                    qoi.push_back(uint8_t(opRun | (run - 1)));
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0) {
+                qoi.push_back(uint8_t(opRun | (run - 1)));
+                run = 0;
+            }
+
+            int hash = colorHash(pixel);
+            const PixelColor& entry = seen[hash];
+            if (seenValid[hash] && entry.r == pixel.r && entry.g == pixel.g && entry.b == pixel.b) {
+                qoi.push_back(uint8_t(opIndex | hash));
+            } else {
+                seen[hash] = pixel;
+                seenValid[hash] = true;
+
+                int8_t dr = int8_t(pixel.r - previous.r);
+                int8_t dg = int8_t(pixel.g - previous.g);
+                int8_t db = int8_t(pixel.b - previous.b);
+                int8_t drg = int8_t(dr - dg);
+                int8_t dbg = int8_t(db - dg);
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                    qoi.push_back(uint8_t(opDiff | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+                } else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+                    qoi.push_back(uint8_t(opLuma | (dg + 32)));
+                    qoi.push_back(uint8_t((drg + 8) << 4 | (dbg + 8)));
+                } else {
+                    qoi.push_back(opRgb);
+                    qoi.push_back(pixel.r);
+                    qoi.push_back(pixel.g);
+                    qoi.push_back(pixel.b);
+                }
+            }
+            previous = pixel;
+        }
+    }
+    if (run > 0) qoi.push_back(uint8_t(opRun | (run - 1)));
+
+    const uint8_t end[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+    qoi.insert(qoi.end(), end, end + 8);
+    return qoi;
+}
+
+bool writeQoi(const std::string& fileName, const Framebuffer& framebuffer) {
+    std::vector<uint8_t> qoi = encodeQoi(framebuffer);
+    std::ofstream out(fileName, std::ios::binary);
+    if (!out) {
+        std::cerr << "Failed to create image file: " << fileName << std::endl;
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(qoi.data()), qoi.size());
+    return bool(out);
+}
@@ -0,0 +1,16 @@
+// QoiWriter.h
+#ifndef QOIWRITER_H
+#define QOIWRITER_H
+
+#include "SoftwareRasterizer.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Encodes framebuffer as a QOI image: lossless like PNG, but a single pass over the pixels that is many
+// times faster to encode and decode
+std::vector<uint8_t> encodeQoi(const Framebuffer& framebuffer);
+
+bool writeQoi(const std::string& fileName, const Framebuffer& framebuffer);
+
+#endif // QOIWRITER_H
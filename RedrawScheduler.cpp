@@ -0,0 +1,62 @@
+// RedrawScheduler.cpp
+#include "RedrawScheduler.h"
+#include <atomic>
+
+namespace {
+    // ImGui needs a few frames after an event before hover and active states settle
+    const int settleFrames = 3;
+
+    std::atomic<int> pendingFrames(settleFrames);
+
+    void markDirty() {
+        pendingFrames.store(settleFrames);
+    }
+
+    void cursorPosCallback(GLFWwindow*, double, double) { markDirty(); }
+    void mouseButtonCallback(GLFWwindow*, int, int, int) { markDirty(); }
+    void scrollCallback(GLFWwindow*, double, double) { markDirty(); }
+    void keyCallback(GLFWwindow*, int, int, int, int) { markDirty(); }
+    void charCallback(GLFWwindow*, unsigned int) { markDirty(); }
+    void windowSizeCallback(GLFWwindow*, int, int) { markDirty(); }
+    void framebufferSizeCallback(GLFWwindow*, int, int) { markDirty(); }
+    void windowRefreshCallback(GLFWwindow*) { markDirty(); }
+    void windowFocusCallback(GLFWwindow*, int) { markDirty(); }
+    void cursorEnterCallback(GLFWwindow*, int) { markDirty(); }
+}
+
+void installRedrawCallbacks(GLFWwindow* window) {
+    glfwSetCursorPosCallback(window, cursorPosCallback);
+    glfwSetMouseButtonCallback(window, mouseButtonCallback);
+    glfwSetScrollCallback(window, scrollCallback);
+    glfwSetKeyCallback(window, keyCallback);
+    glfwSetCharCallback(window, charCallback);
+    glfwSetWindowSizeCallback(window, windowSizeCallback);
+    glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+    glfwSetWindowRefreshCallback(window, windowRefreshCallback);
+    glfwSetWindowFocusCallback(window, windowFocusCallback);
+    glfwSetCursorEnterCallback(window, cursorEnterCallback);
+}
+
+void requestRedraw() {
+    markDirty();
+    glfwPostEmptyEvent();
+}
+
+bool waitForRedraw(bool renderOnDemand, double timeout) {
+    if (!renderOnDemand) {
+        glfwPollEvents();
+        return true;
+    }
+
+    if (pendingFrames.load() > 0) {
+        glfwPollEvents();
+    } else {
+        glfwWaitEventsTimeout(timeout);
+    }
+
+    // Take one pending frame, if there is any
+    int pending = pendingFrames.load();
+    while (pending > 0 && !pendingFrames.compare_exchange_weak(pending, pending - 1)) {
+    }
+    return pending > 0;
+}
@@ -0,0 +1,20 @@
+// RedrawScheduler.h
+#ifndef REDRAWSCHEDULER_H
+#define REDRAWSCHEDULER_H
+
+#include <GLFW/glfw3.h>
+
+// Render-on-demand support: the main loop sleeps in glfwWaitEventsTimeout until input arrives
+// or some part of the program asks for a new frame.
+
+// Marks the window contents dirty for every kind of input; call before ImGui installs its callbacks
+void installRedrawCallbacks(GLFWwindow* window);
+
+// Asks for a repaint. Safe to call from any thread; wakes up the main loop immediately.
+void requestRedraw();
+
+// Processes events, blocking for at most timeout seconds when nothing is dirty in render-on-demand mode.
+// Returns whether a frame has to be drawn.
+bool waitForRedraw(bool renderOnDemand, double timeout);
+
+#endif // REDRAWSCHEDULER_H
@@ -0,0 +1,373 @@
+// RenderDaemon.cpp
+#include "RenderDaemon.h"
+#include "ContentHash.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+    // Largest INI text a render-text request may send, and the longest request line
+    const size_t maxIniTextBytes = size_t(1) << 20;
+    const size_t maxLineBytes = 4096;
+
+    // Connections served at the same time, each by a thread of its own; further ones are turned away
+    const size_t maxConnections = 64;
+
+    // How often the listening loop checks whether it has to stop
+    const int acceptTimeoutMilliseconds = 100;
+
+    double secondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Reads lines and counted blocks of bytes from a connection
+    class SocketReader {
+    private:
+        int socket;
+        std::string buffer;
+        bool overlong;
+
+        bool fill() {
+            char chunk[4096];
+            while (true) {
+                ssize_t count = read(socket, chunk, sizeof(chunk));
+                if (count > 0) {
+                    buffer.append(chunk, size_t(count));
+                    return true;
+                }
+                if (count < 0 && errno == EINTR) continue;
+                return false;
+            }
+        }
+
+    public:
+        explicit SocketReader(int socket) : socket(socket), overlong(false) {
+        }
+
+        // A line without its end; false once the connection is closed or the line is longer than maxLineBytes
+        bool readLine(std::string& line) {
+            size_t end;
+            while ((end = buffer.find('\n')) == std::string::npos) {
+                if (buffer.size() > maxLineBytes) {
+                    overlong = true;
+                    return false;
+                }
+                if (!fill()) return false;
+            }
+            if (end > maxLineBytes) {
+                overlong = true;
+                return false;
+            }
+            line = buffer.substr(0, end);
+            buffer.erase(0, end + 1);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            return true;
+        }
+
+        bool readBytes(size_t count, std::string& bytes) {
+            while (buffer.size() < count) {
+                if (!fill()) return false;
+            }
+            bytes = buffer.substr(0, count);
+            buffer.erase(0, count);
+            return true;
+        }
+
+        bool isOverlong() const {
+            return overlong;
+        }
+    };
+
+    bool writeAll(int socket, const std::string& text) {
+        size_t written = 0;
+        while (written < text.size()) {
+            ssize_t count = write(socket, text.data() + written, text.size() - written);
+            if (count < 0 && errno == EINTR) continue;
+            if (count <= 0) return false;
+            written += size_t(count);
+        }
+        return true;
+    }
+
+    // The latency below which fraction of sorted lies, in milliseconds
+    double percentile(const std::vector<double>& sorted, double fraction) {
+        if (sorted.empty()) return 0.0;
+        size_t index = size_t(std::ceil(fraction * sorted.size()));
+        return 1000.0 * sorted[std::min(sorted.size(), std::max<size_t>(index, 1)) - 1];
+    }
+
+    // Whether the extension of fileName is an image format writeImage writes as itself
+    bool hasImageExtension(const std::string& fileName) {
+        std::string extension = std::filesystem::path(fileName).extension().string();
+        return !extension.empty() && isImageFormat(extension.substr(1));
+    }
+
+    std::string renderReply(bool rendered, bool shared, double seconds, const std::string& output) {
+        if (!rendered) return "error rendering " + output + " failed; the daemon log has the reason";
+        std::ostringstream reply;
+        reply << "ok " << std::fixed << std::setprecision(1) << 1000.0 * seconds << " ms "
+              << (shared ? "shared " : "rendered ") << output;
+        return reply.str();
+    }
+}
+
+RenderDaemon::RenderDaemon(const std::string& socketPath, size_t memoryBudget, const std::string& outputDirectory,
+                           bool overwrite, LSystemCache& cache)
+        : socketPath(socketPath), memoryBudget(memoryBudget), outputDirectory(outputDirectory),
+          overwrite(overwrite), cache(cache), listener(-1), stopping(false),
+          queued(0), running(0), completed(0), failed(0), coalesced(0), latencies(latencyWindow),
+          latencyCount(0) {
+}
+
+RenderDaemon::~RenderDaemon() {
+    if (listener >= 0) close(listener);
+}
+
+bool RenderDaemon::run() {
+    // A client that hangs up before its answer must not end the daemon
+    std::signal(SIGPIPE, SIG_IGN);
+
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Invalid socket path '" << socketPath << "'" << std::endl;
+        return false;
+    }
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        std::cerr << "Failed to create a socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // A socket left behind by a daemon that did not shut down is replaced; one that still answers is not
+    struct stat status;
+    if (stat(socketPath.c_str(), &status) == 0) {
+        if (!S_ISSOCK(status.st_mode)) {
+            std::cerr << socketPath << " exists and is not a socket" << std::endl;
+            return false;
+        }
+        if (connect(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+            std::cerr << "Another daemon is serving " << socketPath << std::endl;
+            return false;
+        }
+        unlink(socketPath.c_str());
+    }
+
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 64) != 0) {
+        std::cerr << "Failed to listen on " << socketPath << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    std::cout << "Serving renders on " << socketPath << " with " << jobSystem().getThreadCount() << " workers"
+              << std::endl;
+
+    while (!stopping) {
+        pollfd descriptor{listener, POLLIN, 0};
+        if (poll(&descriptor, 1, acceptTimeoutMilliseconds) <= 0) continue;
+        int connection = accept(listener, nullptr, nullptr);
+        if (connection < 0) continue;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (connections.size() >= maxConnections) {
+            lock.unlock();
+            writeAll(connection, "error the daemon serves at most " + std::to_string(maxConnections)
+                                 + " connections at a time\n");
+            close(connection);
+            continue;
+        }
+        connections.insert(connection);
+        std::thread([this, connection]() { serve(connection); }).detach();
+    }
+    close(listener);
+    listener = -1;
+    unlink(socketPath.c_str());
+
+    // Open connections read no further requests, but the ones in progress are still answered
+    std::unique_lock<std::mutex> lock(mutex);
+    for (int connection : connections) {
+        shutdown(connection, SHUT_RD);
+    }
+    connectionsClosed.wait(lock, [this]() { return connections.empty(); });
+    lock.unlock();
+
+    std::cout << "Stopped serving renders: " << describeStats() << std::endl;
+    return true;
+}
+
+void RenderDaemon::serve(int connection) {
+    SocketReader reader(connection);
+    std::string line;
+    while (reader.readLine(line)) {
+        auto start = std::chrono::steady_clock::now();
+        std::istringstream words(line);
+        std::string command;
+        words >> command;
+
+        std::string reply;
+        if (command == "render") {
+            std::string format, path;
+            words >> format;
+            std::getline(words >> std::ws, path);
+            if (format.empty() || path.empty()) {
+                reply = "error expected: render FORMAT PATH";
+            } else if (!isImageFormat(format)) {
+                reply = "error unknown image format '" + format + "'; expected bmp, png or qoi";
+            } else {
+                std::string output = outputFileName(path, format, outputDirectory);
+                if (!overwrite && std::filesystem::exists(output)) {
+                    reply = "error " + output + " exists already; the daemon only replaces images with --force";
+                } else {
+                    ContentHash hash('r');
+                    hash.add(path);
+                    hash.add(output);
+                    bool shared;
+                    bool rendered = render(hash.get(), [this, path, output]() {
+                        return renderIniToImage(path, output, memoryBudget, nullptr, &cache);
+                    }, shared);
+                    recordLatency(secondsSince(start));
+                    reply = renderReply(rendered, shared, secondsSince(start), output);
+                }
+            }
+        } else if (command == "render-text") {
+            size_t bytes = 0;
+            std::string output, text;
+            // Without a valid count the text cannot be told apart from the next request, which ends the connection
+            if (!(words >> bytes) || bytes > maxIniTextBytes) {
+                writeAll(connection, "error expected: render-text BYTES OUTPUT, with at most "
+                                     + std::to_string(maxIniTextBytes) + " bytes of INI text\n");
+                break;
+            }
+            std::getline(words >> std::ws, output);
+            if (!reader.readBytes(bytes, text)) break;
+
+            if (output.empty()) {
+                reply = "error expected: render-text BYTES OUTPUT";
+            } else if (!hasImageExtension(output)) {
+                reply = "error " + output + " does not end in an image format; expected .bmp, .png or .qoi";
+            } else if (!overwrite && std::filesystem::exists(output)) {
+                reply = "error " + output + " exists already; the daemon only replaces images with --force";
+            } else {
+                ContentHash hash('t');
+                hash.add(text);
+                hash.add(output);
+                bool shared;
+                bool rendered = render(hash.get(), [this, text, output]() {
+                    ini::Configuration conf;
+                    try {
+                        std::istringstream in(text);
+                        in >> conf;
+                    }
+                    catch (ini::ParseException& ex) {
+                        std::cerr << "Error parsing INI text for " << output << ": " << ex.what() << std::endl;
+                        return false;
+                    }
+                    return renderConfigurationToImage(conf, output, output, memoryBudget, nullptr, &cache);
+                }, shared);
+                recordLatency(secondsSince(start));
+                reply = renderReply(rendered, shared, secondsSince(start), output);
+            }
+        } else if (command == "stats") {
+            reply = "ok " + describeStats();
+        } else if (command == "shutdown") {
+            stopping = true;
+            reply = "ok shutting down";
+        } else {
+            reply = "error unknown request '" + command + "'; expected render, render-text, stats or shutdown";
+        }
+
+        if (!writeAll(connection, reply + "\n")) break;
+    }
+    if (reader.isOverlong()) {
+        writeAll(connection, "error request lines are at most " + std::to_string(maxLineBytes) + " bytes\n");
+    }
+
+    close(connection);
+    std::lock_guard<std::mutex> lock(mutex);
+    connections.erase(connection);
+    connectionsClosed.notify_all();
+}
+
+bool RenderDaemon::render(uint64_t key, std::function<bool()> work, bool& shared) {
+    std::shared_ptr<Flight> flight;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::shared_ptr<Flight>& entry = inFlight[key];
+        shared = entry != nullptr;
+        if (shared) {
+            coalesced++;
+        } else {
+            entry = std::make_shared<Flight>();
+            queued++;
+        }
+        flight = entry;
+    }
+
+    if (!shared) {
+        jobSystem().submit([this, key, flight, work]() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queued--;
+                running++;
+            }
+            bool rendered = work();
+            {
+                // Requests from now on render again, since the file may have changed
+                std::lock_guard<std::mutex> lock(mutex);
+                running--;
+                if (rendered) {
+                    completed++;
+                } else {
+                    failed++;
+                }
+                inFlight.erase(key);
+            }
+
+            std::lock_guard<std::mutex> lock(flight->mutex);
+            flight->rendered = rendered;
+            flight->finished = true;
+            flight->done.notify_all();
+        }, JobPriority::Background);
+    }
+
+    std::unique_lock<std::mutex> lock(flight->mutex);
+    flight->done.wait(lock, [&flight]() { return flight->finished; });
+    return flight->rendered;
+}
+
+void RenderDaemon::recordLatency(double seconds) {
+    std::lock_guard<std::mutex> lock(mutex);
+    latencies[latencyCount % latencyWindow] = seconds;
+    latencyCount++;
+}
+
+std::string RenderDaemon::describeStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<double> sorted(latencies.begin(), latencies.begin() + std::min(latencyCount, latencyWindow));
+    std::sort(sorted.begin(), sorted.end());
+
+    std::ostringstream stats;
+    stats << "queued " << queued << ", running " << running << ", connections " << connections.size()
+          << "; rendered " << completed << ", failed " << failed << ", shared " << coalesced << "; latency of the last "
+          << sorted.size() << " requests p50 " << std::fixed << std::setprecision(1) << percentile(sorted, 0.5)
+          << " ms, p90 " << percentile(sorted, 0.9) << " ms, p99 " << percentile(sorted, 0.99) << " ms"
+          << "; L-System files parsed " << cache.getSystemLoads() << " of " << cache.getSystemRequests()
+          << " times, expanded " << cache.getExpansionLoads() - cache.getExpansionDiskLoads() << " of "
+          << cache.getExpansionRequests() << " times";
+    return stats.str();
+}
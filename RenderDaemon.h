@@ -0,0 +1,82 @@
+// RenderDaemon.h
+#ifndef RENDERDAEMON_H
+#define RENDERDAEMON_H
+
+#include "HeadlessRenderer.h"
+#include "LSystemCache.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+// Long-running headless renderer that serves requests over a Unix domain socket, one per line:
+//   render FORMAT PATH        renders the INI file PATH to an image of FORMAT (bmp, png or qoi) named after
+//                             it, next to it or in the output directory of the daemon
+//   render-text BYTES OUTPUT  renders the BYTES bytes of INI text that follow the line to OUTPUT, in the
+//                             format of its extension, which has to be one of those as well
+//   stats                     reports the queue depth, request counts and latency percentiles
+//   shutdown                  stops accepting connections once the requests in progress are answered
+// Every request is answered with one line starting with ok or error; paths are relative to the working
+// directory of the daemon, and existing images are only replaced by a daemon that may overwrite them. Every
+// connection is served by a thread of its own, in order, up to a fixed number of connections, while the
+// renders run as background jobs of the shared job system. Request lines and INI texts have a size limit,
+// past which the connection is closed. A request equal to one still in progress waits for that one instead
+// of rendering again, and parsed L-Systems and their expansions stay in the cache between requests.
+class RenderDaemon {
+private:
+    // One render in progress, shared by every request that asked for it
+    struct Flight {
+        std::mutex mutex;
+        std::condition_variable done;
+        bool finished = false;
+        bool rendered = false;
+    };
+
+    std::string socketPath;
+    size_t memoryBudget;
+    std::string outputDirectory;
+    bool overwrite;
+    LSystemCache& cache;
+    int listener;
+    std::atomic<bool> stopping;
+
+    // Guards everything below
+    std::mutex mutex;
+    std::map<uint64_t, std::shared_ptr<Flight>> inFlight;
+    std::set<int> connections;
+    std::condition_variable connectionsClosed;
+    size_t queued, running, completed, failed, coalesced;
+    std::vector<double> latencies;      // seconds of the latest requests, used as a ring
+    size_t latencyCount;
+
+    void serve(int connection);
+
+    // Runs work as a job unless a request with key is in progress already, then waits for whichever it is
+    bool render(uint64_t key, std::function<bool()> work, bool& shared);
+    void recordLatency(double seconds);
+    std::string describeStats();
+
+public:
+    // Latencies kept for the percentiles
+    static const size_t latencyWindow = 4096;
+
+    // Images of render requests go to outputDirectory unless it is empty; existing images are replaced only
+    // when overwrite is set
+    RenderDaemon(const std::string& socketPath, size_t memoryBudget, const std::string& outputDirectory,
+                 bool overwrite, LSystemCache& cache);
+    ~RenderDaemon();
+
+    RenderDaemon(const RenderDaemon&) = delete;
+    RenderDaemon& operator=(const RenderDaemon&) = delete;
+
+    // Serves requests until one asks for a shutdown; returns false when the socket cannot be set up
+    bool run();
+};
+
+#endif // RENDERDAEMON_H
@@ -0,0 +1,336 @@
+// SceneGenerator.cpp
+#include "SceneGenerator.h"
+#include "JobSystem.h"
+#include "LSystemCache.h"
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iostream>
+
+using namespace glm;
+
+namespace {
+    // Symbols of the current string expanded by one job
+    const size_t expansionGrain = 1 << 16;
+
+    void beginStage(LoadProgress* progress, LoadStage stage) {
+        if (progress) progress->begin(stage);
+    }
+
+    void finishStage(LoadProgress* progress, LoadStage stage, bool cached = false) {
+        if (progress) progress->finish(stage, cached);
+    }
+
+    // Stages that only exist for L-Systems
+    void skipL2DStages(LoadProgress* progress) {
+        if (!progress) return;
+        progress->skip(LoadStage::L2DParse);
+        progress->skip(LoadStage::Expansion);
+    }
+
+    bool isCancelled(const LoadProgress* progress) {
+        return progress && progress->isCancelled();
+    }
+}
+
+LineCollector::LineCollector(std::vector<LineData>& lines)
+        : lines(lines) {
+}
+
+void LineCollector::addLine(const LineData& line) {
+    lines.push_back(line);
+}
+
+void LineCollector::reserve(size_t count) {
+    lines.reserve(lines.size() + count);
+}
+
+// Creates lines for a colored rectangle
+void renderRectangle(const ini::Configuration &conf, LineSink& sink, LoadProgress* progress) {
+    int width = (conf["ImageProperties"]["width"].as_int_or_die());
+    int height = (conf["ImageProperties"]["height"].as_int_or_die());
+
+    skipL2DStages(progress);
+    beginStage(progress, LoadStage::Turtle);
+    if (progress) progress->setExpectedLines(4);
+    sink.reserve(4);
+
+    // For a rectangle, we'll just create the border lines
+    LineData line1, line2, line3, line4;
+
+    // Define rectangle corners
+    vec3 topLeft(-sceneExtent, sceneExtent, 0.0f);
+    vec3 topRight(sceneExtent, sceneExtent, 0.0f);
+    vec3 bottomRight(sceneExtent, -sceneExtent, 0.0f);
+    vec3 bottomLeft(-sceneExtent, -sceneExtent, 0.0f);
+
+    // Define colors
+    vec3 redColor(1.0f, 0.0f, 0.0f);
+    vec3 greenColor(0.0f, 1.0f, 0.0f);
+    vec3 blueColor(0.0f, 0.0f, 1.0f);
+    vec3 yellowColor(1.0f, 1.0f, 0.0f);
+
+    // Create the four sides of the rectangle
+    line1.start = topLeft;
+    line1.end = topRight;
+    line1.color = redColor;
+
+    line2.start = topRight;
+    line2.end = bottomRight;
+    line2.color = greenColor;
+
+    line3.start = bottomRight;
+    line3.end = bottomLeft;
+    line3.color = blueColor;
+
+    line4.start = bottomLeft;
+    line4.end = topLeft;
+    line4.color = yellowColor;
+
+    // Hand the lines to the sink
+    sink.addLine(line1);
+    sink.addLine(line2);
+    sink.addLine(line3);
+    sink.addLine(line4);
+    finishStage(progress, LoadStage::Turtle);
+}
+
+// Creates lines for a checkerboard pattern
+void renderBlocks(const ini::Configuration &conf, LineSink& sink, LoadProgress* progress) {
+    int nrXBlocks = (conf["BlockProperties"]["nrXBlocks"].as_int_or_die());
+    int nrYBlocks = (conf["BlockProperties"]["nrYBlocks"].as_int_or_die());
+    std::vector<double> colorA = (conf["BlockProperties"]["colorWhite"].as_double_tuple_or_die());
+    std::vector<double> colorB = (conf["BlockProperties"]["colorBlack"].as_double_tuple_or_die());
+
+    // Convert the configuration colors to vec3
+    vec3 colorAvec(colorA[0], colorA[1], colorA[2]);
+    vec3 colorBvec(colorB[0], colorB[1], colorB[2]);
+
+    skipL2DStages(progress);
+    beginStage(progress, LoadStage::Turtle);
+    if (progress) progress->setExpectedLines(nrXBlocks + nrYBlocks + 2);
+    sink.reserve(nrXBlocks + nrYBlocks + 2);
+
+    // Create a grid of lines to represent the checkerboard
+    float blockWidth = 2.0f * sceneExtent / nrXBlocks;
+    float blockHeight = 2.0f * sceneExtent / nrYBlocks;
+    float startX = -sceneExtent;
+    float startY = -sceneExtent;
+
+    // Create horizontal grid lines
+    for (int y = 0; y <= nrYBlocks; y++) {
+        LineData line;
+        line.start = vec3(startX, startY + y * blockHeight, 0.0f);
+        line.end = vec3(startX + nrXBlocks * blockWidth, startY + y * blockHeight, 0.0f);
+        line.color = vec3(0.5f, 0.5f, 0.5f); // Gray lines
+        sink.addLine(line);
+    }
+
+    // Create vertical grid lines
+    for (int x = 0; x <= nrXBlocks; x++) {
+        LineData line;
+        line.start = vec3(startX + x * blockWidth, startY, 0.0f);
+        line.end = vec3(startX + x * blockWidth, startY + nrYBlocks * blockHeight, 0.0f);
+        line.color = vec3(0.5f, 0.5f, 0.5f); // Gray lines
+        sink.addLine(line);
+    }
+    finishStage(progress, LoadStage::Turtle);
+}
+
+std::pmr::string expandLSystem(const LParser::LSystem2D& system, LoadProgress* progress,
+                               std::pmr::memory_resource* memory) {
+    const std::set<char>& alphabet = system.get_alphabet();
+    unsigned int iterations = system.get_nr_iterations();
+
+    // Replacement of every symbol; symbols outside the alphabet are kept as they are
+    std::pmr::vector<std::pmr::string> replacements(256, memory);
+    for (int c = 0; c < 256; c++) {
+        char symbol = char(c);
+        if (alphabet.find(symbol) != alphabet.end()) {
+            replacements[c] = system.get_replacement(symbol);
+        } else {
+            replacements[c].assign(1, symbol);
+        }
+    }
+
+    // Generate the L-System string. Every iteration measures the expansion of each block of symbols,
+    // turns the lengths into offsets and then writes all blocks in parallel.
+    std::pmr::string mainstring(system.get_initiator(), memory);
+    std::pmr::string tempstring(memory);
+    std::pmr::vector<size_t> offsets(memory);
+    for (unsigned int i = 0; i < iterations; i++) {
+        size_t blockCount = (mainstring.size() + expansionGrain - 1) / expansionGrain;
+        offsets.assign(blockCount, 0);
+        parallelFor(0, blockCount, 1, [&](size_t first, size_t last) {
+            for (size_t block = first; block < last; block++) {
+                size_t end = std::min(mainstring.size(), (block + 1) * expansionGrain);
+                size_t length = 0;
+                for (size_t j = block * expansionGrain; j < end; j++) {
+                    length += replacements[(unsigned char)mainstring[j]].size();
+                }
+                offsets[block] = length;
+            }
+        });
+        size_t total = parallelScan(offsets, size_t(0), std::plus<size_t>(), 1024);
+
+        tempstring.resize(total);
+        parallelFor(0, blockCount, 1, [&](size_t first, size_t last) {
+            for (size_t block = first; block < last; block++) {
+                if (isCancelled(progress)) return;
+
+                char* out = &tempstring[0] + offsets[block];
+                size_t end = std::min(mainstring.size(), (block + 1) * expansionGrain);
+                for (size_t j = block * expansionGrain; j < end; j++) {
+                    const std::pmr::string& replacement = replacements[(unsigned char)mainstring[j]];
+                    out = std::copy(replacement.begin(), replacement.end(), out);
+                }
+            }
+        });
+        mainstring.swap(tempstring);
+
+        if (isCancelled(progress)) return std::pmr::string(memory);
+        if (progress) progress->update(LoadStage::Expansion, float(i + 1) / iterations);
+    }
+    return mainstring;
+}
+
+double countLSystemLines(const LParser::LSystem2D& system) {
+    const std::set<char>& alphabet = system.get_alphabet();
+
+    // Segments drawn by every symbol after the iterations done so far, starting from none
+    std::vector<double> lines(256, 0.0);
+    for (char symbol : alphabet) {
+        if (system.draw(symbol)) lines[(unsigned char)symbol] = 1.0;
+    }
+    for (unsigned int i = 0; i < system.get_nr_iterations(); i++) {
+        std::vector<double> next(256, 0.0);
+        for (char symbol : alphabet) {
+            for (char c : system.get_replacement(symbol)) next[(unsigned char)symbol] += lines[(unsigned char)c];
+        }
+        lines.swap(next);
+    }
+
+    double total = 0;
+    for (char c : system.get_initiator()) total += lines[(unsigned char)c];
+    return total;
+}
+
+LSystemSymbols::LSystemSymbols(const LParser::LSystem2D& system)
+        : iterations(system.get_nr_iterations()), initiator(system.get_initiator()),
+          replacements(256), rewritten(256, false) {
+    for (char symbol : system.get_alphabet()) {
+        replacements[(unsigned char)symbol] = system.get_replacement(symbol);
+        rewritten[(unsigned char)symbol] = true;
+    }
+}
+
+bool readLSystem(const std::string& fileName, LParser::LSystem2D& system) {
+    std::ifstream L2DFile(fileName);
+    if (!L2DFile) {
+        std::cerr << "Failed to open L-System file: " << fileName << std::endl;
+        return false;
+    }
+    L2DFile >> system;
+    return true;
+}
+
+// Renders an L-System 2D drawing
+void renderL2D(const ini::Configuration &conf, LineSink& sink, LoadProgress* progress,
+               std::pmr::memory_resource* memory) {
+    int size = (conf["General"]["size"].as_int_or_die());
+    std::vector<double> backgroundColor = (conf["General"]["backgroundcolor"].as_double_tuple_or_die());
+    std::vector<double> lineColor = (conf["2DLSystem"]["color"].as_double_tuple_or_die());
+    std::string L2DFileName = (conf["2DLSystem"]["inputfile"].as_string_or_die());
+
+    // Convert the line color to vec3
+    vec3 lineColorVec(lineColor[0], lineColor[1], lineColor[2]);
+
+    // Load L-System
+    beginStage(progress, LoadStage::L2DParse);
+    bool cached = false;
+    std::shared_ptr<const LParser::LSystem2D> system = lsystemCache().getSystem(L2DFileName, &cached);
+    if (!system) {
+        if (progress) progress->failRunning();
+        return;
+    }
+    const LParser::LSystem2D& LPARSER = *system;
+    finishStage(progress, LoadStage::L2DParse, cached);
+
+    // Loading the same rules again takes the expansion from the shared cache, also when only the angles changed
+    beginStage(progress, LoadStage::Expansion);
+    std::shared_ptr<const std::pmr::string> expansion = lsystemCache().getExpansion(LPARSER, progress, &cached);
+    const std::pmr::string& mainstring = *expansion;
+    finishStage(progress, LoadStage::Expansion, cached);
+    if (isCancelled(progress)) return;
+
+    // Reports turtle progress; the two passes over the path each take half of the stage
+    beginStage(progress, LoadStage::Turtle);
+    double pathLength = double(std::max<size_t>(1, mainstring.size()));
+    float passOffset = 0.0f;
+    auto tick = [&](size_t position) {
+        if (!progress) return true;
+        progress->update(LoadStage::Turtle, passOffset + float(0.5 * position / pathLength));
+        return !progress->isCancelled();
+    };
+
+    // First pass: find min and max of the path, so lines can be normalized as they are produced.
+    // Nothing reaches the sink before this pass is done, so streaming only starts with the second one.
+    size_t lineCount = 0;
+    double minX = 0, maxX = 0, minY = 0, maxY = 0;
+    traceLSystem(LPARSER, mainstring, [&](double x0, double y0, double x1, double y1) {
+        if (lineCount++ == 0) {
+            minX = maxX = x0;
+            minY = maxY = y0;
+        }
+        minX = std::min(minX, std::min(x0, x1));
+        maxX = std::max(maxX, std::max(x0, x1));
+        minY = std::min(minY, std::min(y0, y1));
+        maxY = std::max(maxY, std::max(y0, y1));
+        return true;
+    }, tick, memory);
+    if (lineCount == 0 || isCancelled(progress)) {
+        finishStage(progress, LoadStage::Turtle);
+        return;
+    }
+    if (progress) progress->setExpectedLines(lineCount);
+    sink.reserve(lineCount);
+
+    // Calculate scale factor
+    double width = maxX - minX;
+    double height = maxY - minY;
+    double scale = 2.0 * sceneExtent / std::max(width, height);
+
+    // Center and scale
+    double centerX = (minX + maxX) / 2.0;
+    double centerY = (minY + maxY) / 2.0;
+
+    // Second pass: trace the path again and hand out the normalized line segments
+    passOffset = 0.5f;
+    traceLSystem(LPARSER, mainstring, [&](double x0, double y0, double x1, double y1) {
+        LineData line;
+        line.start = vec3(float((x0 - centerX) * scale), float((y0 - centerY) * scale), 0.0f);
+        line.end = vec3(float((x1 - centerX) * scale), float((y1 - centerY) * scale), 0.0f);
+        line.color = lineColorVec;
+        sink.addLine(line);
+        return true;
+    }, tick, memory);
+    finishStage(progress, LoadStage::Turtle);
+}
+
+// Main render function that calls the appropriate renderer
+bool renderScene(const ini::Configuration &conf, LineSink& sink, LoadProgress* progress,
+                 std::pmr::memory_resource* memory) {
+    if (conf["General"]["type"].as_string_or_die() == "IntroColorRectangle") {
+        renderRectangle(conf, sink, progress);
+    }
+    else if (conf["General"]["type"].as_string_or_die() == "IntroBlocks") {
+        renderBlocks(conf, sink, progress);
+    }
+    else if (conf["General"]["type"].as_string_or_die() == "2DLSystem") {
+        renderL2D(conf, sink, progress, memory);
+    }
+    else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,317 @@
+// SceneGenerator.h
+#ifndef SCENEGENERATOR_H
+#define SCENEGENERATOR_H
+
+#include "LineData.h"
+#include "LoadProgress.h"
+#include "ini_configuration.h"
+#include "l_parser.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory_resource>
+#include <stack>
+#include <string>
+#include <vector>
+
+// Receives the segments of a scene in the order they are generated
+class LineSink {
+public:
+    virtual ~LineSink() {}
+    virtual void addLine(const LineData& line) = 0;
+
+    // Called before the segments are generated once their number is known
+    virtual void reserve(size_t /*count*/) {}
+};
+
+// Collects all segments into a vector
+class LineCollector : public LineSink {
+private:
+    std::vector<LineData>& lines;
+
+public:
+    explicit LineCollector(std::vector<LineData>& lines);
+    void addLine(const LineData& line) override;
+    void reserve(size_t count) override;
+};
+
+// Every scene is generated inside the square [-sceneExtent, sceneExtent]
+const float sceneExtent = 0.8f;
+
+// Number of segments or symbols processed between two cancellation checks
+const unsigned int cancelCheckInterval = 4096;
+
+// The generators report their stages to progress when given one, and stop early once it is cancelled.
+// Their temporary data (turtle stacks) is allocated from memory; L-Systems and their expanded strings
+// come from lsystemCache().
+void renderRectangle(const ini::Configuration &conf, LineSink& sink, LoadProgress* progress = nullptr);
+void renderBlocks(const ini::Configuration &conf, LineSink& sink, LoadProgress* progress = nullptr);
+void renderL2D(const ini::Configuration &conf, LineSink& sink, LoadProgress* progress = nullptr,
+               std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+// Generates the scene described by conf; returns false for unknown types
+bool renderScene(const ini::Configuration &conf, LineSink& sink, LoadProgress* progress = nullptr,
+                 std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+// Parses an L-System file; returns false when it cannot be opened
+bool readLSystem(const std::string& fileName, LParser::LSystem2D& system);
+
+// Applies the replacement rules nrIterations times to the initiator
+std::pmr::string expandLSystem(const LParser::LSystem2D& system, LoadProgress* progress = nullptr,
+                               std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+// Number of segments the turtle draws for the expanded string, counted per symbol and iteration without
+// expanding it. A double, since deep systems overflow any integer.
+double countLSystemLines(const LParser::LSystem2D& system);
+
+// The expanded string of an L-System generated symbol by symbol, depth first, instead of being stored.
+// Only a stack with one position per iteration is kept, so it can be traced any number of times
+// without the memory of expandLSystem.
+class LSystemSymbols {
+private:
+    unsigned int iterations;
+    std::string initiator;
+    std::vector<std::string> replacements;
+    std::vector<bool> rewritten;
+
+public:
+    explicit LSystemSymbols(const LParser::LSystem2D& system);
+
+    class iterator {
+    private:
+        struct Frame {
+            const std::string* text;
+            size_t index;
+        };
+
+        const LSystemSymbols* symbols;
+        std::vector<Frame> stack;
+
+        // Descends into replacements until the top of the stack is on a symbol that is not rewritten anymore
+        void settle() {
+            while (!stack.empty()) {
+                Frame& top = stack.back();
+                if (top.index == top.text->size()) {
+                    stack.pop_back();
+                    if (!stack.empty()) stack.back().index++;
+                    continue;
+                }
+                unsigned char c = (unsigned char)(*top.text)[top.index];
+                if (stack.size() > symbols->iterations || !symbols->rewritten[c]) return;
+                stack.push_back(Frame{&symbols->replacements[c], 0});
+            }
+        }
+
+    public:
+        iterator() : symbols(nullptr) {}
+        explicit iterator(const LSystemSymbols* symbols) : symbols(symbols) {
+            stack.reserve(symbols->iterations + 1);
+            stack.push_back(Frame{&symbols->initiator, 0});
+            settle();
+        }
+
+        char operator*() const {
+            return (*stack.back().text)[stack.back().index];
+        }
+        iterator& operator++() {
+            stack.back().index++;
+            settle();
+            return *this;
+        }
+        // Only comparing against end() is meaningful
+        bool operator!=(const iterator& other) const {
+            return stack.size() != other.stack.size();
+        }
+    };
+
+    iterator begin() const {
+        return iterator(this);
+    }
+    iterator end() const {
+        return iterator();
+    }
+};
+
+// The turtle that walks an expanded L-System. A copy continues the walk exactly as the original would,
+// so a trace can be resumed from any saved turtle.
+class LSystemTurtle {
+private:
+    const LParser::LSystem2D* system;
+    const std::set<char>* alphabet;
+
+    double currentX;
+    double currentY;
+    double currentAngle;
+    double angle;
+
+    std::stack<double, std::pmr::vector<double>> positionX;
+    std::stack<double, std::pmr::vector<double>> positionY;
+    std::stack<double, std::pmr::vector<double>> positionAngle;
+
+public:
+    explicit LSystemTurtle(const LParser::LSystem2D& system,
+                           std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+            : system(&system), alphabet(&system.get_alphabet()), currentX(0), currentY(0),
+              currentAngle(system.get_starting_angle() * (M_PI / 180)), angle(system.get_angle() * (M_PI / 180)),
+              positionX(std::pmr::vector<double>(memory)), positionY(std::pmr::vector<double>(memory)),
+              positionAngle(std::pmr::vector<double>(memory)) {
+    }
+
+    // Moves the turtle for symbol c and calls emit(x0, y0, x1, y1) if it draws; returns false when emit does
+    template <typename Emit>
+    bool step(char c, Emit& emit) {
+        if (alphabet->find(c) != alphabet->end()) {
+            if (system->draw(c) != false) {
+                double nextX = currentX + system->draw(c) * cos(currentAngle);
+                double nextY = currentY + system->draw(c) * sin(currentAngle);
+
+                if (!emit(currentX, currentY, nextX, nextY)) return false;
+
+                currentX = nextX;
+                currentY = nextY;
+            } else {
+                currentX = currentX + system->draw(c) * cos(currentAngle);
+                currentY = currentY + system->draw(c) * sin(currentAngle);
+            }
+        }
+        if (c == '+') {
+            currentAngle += angle;
+        }
+        else if (c == '-') {
+            currentAngle -= angle;
+        } else if (c == '(') {
+            positionX.push(currentX);
+            positionY.push(currentY);
+            positionAngle.push(currentAngle);
+        } else if (c == ')') {
+            currentX = positionX.top();
+            currentY = positionY.top();
+            currentAngle = positionAngle.top();
+            positionX.pop();
+            positionY.pop();
+            positionAngle.pop();
+        }
+        return true;
+    }
+};
+
+// The walk of the turtle over an expanded L-System with the heading of every segment stored as a number of
+// turns, so it can be traced again for any Angle and StartingAngle without the string. A segment takes 4 bytes
+// and its direction comes from a table of the headings that occur instead of cos and sin per segment. Headings
+// are StartingAngle + turns * Angle rather than the running sum of LSystemTurtle, which can differ in the last
+// bits and so move a truncated pixel now and then.
+class LSystemWalk {
+private:
+    // Steps that save and restore the position; every other step draws a segment at that many turns
+    static constexpr int32_t pushStep = INT32_MIN;
+    static constexpr int32_t popStep = INT32_MIN + 1;
+
+    // Most headings kept in a table; walks that turn further compute every direction
+    static constexpr size_t maxTableHeadings = 1 << 16;
+
+    std::vector<int32_t> steps;
+    int32_t minTurns, maxTurns;
+    size_t lineCount;
+
+public:
+    // path is either the result of expandLSystem or LSystemSymbols
+    template <typename Path>
+    LSystemWalk(const LParser::LSystem2D& system, const Path& path) : minTurns(0), maxTurns(0), lineCount(0) {
+        std::vector<bool> draws(256, false);
+        for (char symbol : system.get_alphabet()) draws[(unsigned char)symbol] = system.draw(symbol);
+
+        int32_t turns = 0;
+        std::vector<int32_t> savedTurns;
+        for (char c : path) {
+            if (draws[(unsigned char)c]) {
+                steps.push_back(turns);
+                minTurns = std::min(minTurns, turns);
+                maxTurns = std::max(maxTurns, turns);
+                lineCount++;
+            }
+            if (c == '+') {
+                turns++;
+            } else if (c == '-') {
+                turns--;
+            } else if (c == '(') {
+                savedTurns.push_back(turns);
+                steps.push_back(pushStep);
+            } else if (c == ')' && !savedTurns.empty()) {
+                turns = savedTurns.back();
+                savedTurns.pop_back();
+                steps.push_back(popStep);
+            }
+        }
+    }
+
+    size_t getLineCount() const {
+        return lineCount;
+    }
+
+    // Calls emit(x0, y0, x1, y1) for every segment, with the angles in degrees; stops when emit returns false
+    template <typename Emit>
+    void trace(double startingAngle, double angle, Emit emit) const {
+        double start = startingAngle * (M_PI / 180);
+        double turn = angle * (M_PI / 180);
+
+        size_t headingCount = size_t(int64_t(maxTurns) - minTurns + 1);
+        bool tabled = headingCount <= maxTableHeadings;
+        std::vector<double> cosines, sines;
+        if (tabled) {
+            cosines.resize(headingCount);
+            sines.resize(headingCount);
+            for (size_t i = 0; i < headingCount; i++) {
+                double heading = start + (minTurns + int64_t(i)) * turn;
+                cosines[i] = cos(heading);
+                sines[i] = sin(heading);
+            }
+        }
+
+        double x = 0, y = 0;
+        std::vector<double> savedX, savedY;
+        for (int32_t step : steps) {
+            if (step == pushStep) {
+                savedX.push_back(x);
+                savedY.push_back(y);
+            } else if (step == popStep) {
+                x = savedX.back();
+                y = savedY.back();
+                savedX.pop_back();
+                savedY.pop_back();
+            } else {
+                double nextX, nextY;
+                if (tabled) {
+                    nextX = x + cosines[step - minTurns];
+                    nextY = y + sines[step - minTurns];
+                } else {
+                    nextX = x + cos(start + step * turn);
+                    nextY = y + sin(start + step * turn);
+                }
+                if (!emit(x, y, nextX, nextY)) return;
+                x = nextX;
+                y = nextY;
+            }
+        }
+    }
+};
+
+// Walks the turtle over an expanded L-System string and calls emit(x0, y0, x1, y1) for every drawn segment.
+// path is either the result of expandLSystem or LSystemSymbols.
+// Every cancelCheckInterval symbols tick(position) is called. Stops early when emit or tick returns false.
+template <typename Path, typename Emit, typename Tick>
+void traceLSystem(const LParser::LSystem2D& system, const Path& path, Emit emit, Tick tick,
+                  std::pmr::memory_resource* memory = std::pmr::get_default_resource()) {
+    LSystemTurtle turtle(system, memory);
+    size_t position = 0;
+    for (char c: path) {
+        if (++position % cancelCheckInterval == 0 && !tick(position)) return;
+        if (!turtle.step(c, emit)) return;
+    }
+}
+
+template <typename Path, typename Emit>
+void traceLSystem(const LParser::LSystem2D& system, const Path& path, Emit emit) {
+    traceLSystem(system, path, emit, [](size_t) { return true; });
+}
+
+#endif // SCENEGENERATOR_H
@@ -0,0 +1,318 @@
+// SceneStreamer.cpp
+#include "SceneStreamer.h"
+#include "GeometryCache.h"
+#include "JobSystem.h"
+#include "RedrawScheduler.h"
+#include "SceneGenerator.h"
+#include "ini_configuration.h"
+#include "l_parser.h"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+namespace {
+    // Keeps every generated line and forwards copies to the GL thread in chunks
+    class StreamingSink : public LineSink {
+    private:
+        std::vector<LineData>& lines;
+        LineChunk chunk;
+        SpscRing<LineChunk>& ring;
+        const LoadProgress& progress;
+
+    public:
+        StreamingSink(std::vector<LineData>& lines, SpscRing<LineChunk>& ring, const LoadProgress& progress,
+                      std::pmr::memory_resource* memory)
+                : lines(lines), chunk(memory), ring(ring), progress(progress) {
+            chunk.reserve(SceneStreamer::chunkSize);
+        }
+
+        void reserve(size_t count) override {
+            lines.reserve(lines.size() + count);
+        }
+
+        void addLine(const LineData& line) override {
+            lines.push_back(line);
+            chunk.push_back(line);
+            if (chunk.size() == SceneStreamer::chunkSize) {
+                flush();
+            }
+        }
+
+        void flush() {
+            if (chunk.empty()) return;
+
+            // Wait for the GL thread to make room, unless the load was cancelled
+            while (!ring.tryPush(std::move(chunk))) {
+                if (progress.isCancelled()) return;
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+            chunk.clear();
+            chunk.reserve(SceneStreamer::chunkSize);
+            requestRedraw();
+        }
+    };
+
+    // A stage whose output is already at hand
+    void reuseStage(LoadProgress& progress, LoadStage stage) {
+        progress.begin(stage);
+        progress.finish(stage, true);
+    }
+}
+
+SceneInfo::SceneInfo()
+        : renderType("None"), hasBackgroundColor(false), backgroundColor(0.0f) {
+}
+
+SceneStreamer::LoadJob::LoadJob(std::shared_ptr<LoadArena> arena)
+        : arena(arena), ring(ringCapacity, [&arena]() { return LineChunk(arena->resource()); }),
+          finished(false), resultReady(false), infoTaken(false), uploadedLines(0), uploadedGeometryKey(0),
+          geometryReused(false) {
+}
+
+SceneStreamer::SceneStreamer()
+        : active(false) {
+}
+
+SceneStreamer::~SceneStreamer() {
+    cancel();
+
+    // Cancelled loads still request redraws until they notice
+    while (!retired.empty()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        reapRetired();
+    }
+}
+
+void SceneStreamer::start(const std::string& iniFile, float finestPixelSize, uint64_t uploadedGeometryKey) {
+    // A load whose result was taken only has to set finished; waiting for it keeps its arena
+    while (current && current->resultReady && !current->finished) {
+        std::this_thread::yield();
+    }
+
+    cancel();
+    if (current && current->finished) {
+        recycleArena(*current);
+    }
+
+    // Everything the previous load allocated from the arena is dropped at once
+    std::shared_ptr<LoadArena> arena = spareArena ? spareArena : std::make_shared<LoadArena>();
+    spareArena.reset();
+    arena->reset();
+
+    std::shared_ptr<LoadJob> job = std::make_shared<LoadJob>(arena);
+    job->uploadedGeometryKey = uploadedGeometryKey;
+    current = job;
+    active = true;
+    jobSystem().submit([job, iniFile, finestPixelSize]() { run(*job, iniFile, finestPixelSize); },
+                       JobPriority::Interactive);
+}
+
+void SceneStreamer::cancel() {
+    reapRetired();
+    if (!current || current->finished || current->progress.isCancelled()) {
+        active = false;
+        return;
+    }
+
+    current->progress.cancel();
+    retired.push_back(current);
+    active = false;
+}
+
+void SceneStreamer::reapRetired() {
+    for (size_t i = 0; i < retired.size();) {
+        if (retired[i]->finished) {
+            recycleArena(*retired[i]);
+            retired.erase(retired.begin() + i);
+        } else {
+            i++;
+        }
+    }
+}
+
+bool SceneStreamer::isActive() {
+    reapRetired();
+
+    // The worker gave up without a result: a parse error or an unknown scene type
+    if (active && current->finished && !current->resultReady) {
+        active = false;
+    }
+    return active;
+}
+
+void SceneStreamer::recycleArena(LoadJob& job) {
+    // Chunks nobody will draw anymore; their memory belongs to the arena
+    LineChunk chunk(job.arena->resource());
+    while (job.ring.tryPop(chunk)) {
+    }
+
+    if (!spareArena) spareArena = job.arena;
+}
+
+void SceneStreamer::run(LoadJob& job, const std::string& iniFile, float finestPixelSize) {
+    load(job, iniFile, finestPixelSize);
+
+    // Nothing of the load touches the arena anymore once finished is set
+    requestRedraw();
+    job.finished = true;
+}
+
+void SceneStreamer::load(LoadJob& job, const std::string& iniFile, float finestPixelSize) {
+    LoadProgress& progress = job.progress;
+    std::pmr::memory_resource* memory = job.arena->resource();
+    std::vector<LineData> lines;
+    StreamingSink sink(lines, job.ring, progress, memory);
+
+    try {
+        progress.begin(LoadStage::IniParse);
+        ini::Configuration conf;
+        std::ifstream fin(iniFile);
+        if (fin.peek() == std::istream::traits_type::eof()) {
+            std::cout << "Ini file appears empty. Does '" << iniFile << "' exist?" << std::endl;
+            progress.failRunning();
+            return;
+        }
+
+        // The text is kept for the geometry cache key
+        std::ostringstream iniText;
+        iniText << fin.rdbuf();
+        fin.close();
+        std::istringstream iniIn(iniText.str());
+        iniIn >> conf;
+
+        job.info.renderType = conf["General"]["type"].as_string_or_die();
+        std::vector<double> backgroundColor;
+        if (conf["General"]["backgroundcolor"].as_double_tuple_if_exists(backgroundColor)) {
+            job.info.hasBackgroundColor = true;
+            job.info.backgroundColor = glm::vec3(backgroundColor[0], backgroundColor[1], backgroundColor[2]);
+        }
+        if (job.info.renderType == "2DLSystem") {
+            conf["2DLSystem"]["inputfile"].as_string_if_exists(job.info.inputFile);
+        }
+        progress.finish(LoadStage::IniParse);
+        std::cout << "Loaded configuration with type: " << job.info.renderType << std::endl;
+        requestRedraw();
+
+        // Everything after the INI file is keyed by what the geometry is made from. Geometry that is still
+        // uploaded, or that the geometry cache holds, is used again and only its palette is updated.
+        SceneGeometryKey geometryKey = sceneGeometryKey(iniText.str(), conf, finestPixelSize);
+        job.geometryReused = job.uploadedGeometryKey != 0 && geometryKey.key == job.uploadedGeometryKey;
+        if (job.geometryReused || geometryCache().load(geometryKey.key, job.result)) {
+            job.result.geometryKey = geometryKey.key;
+            applyLineColor(job.result, geometryKey);
+            if (geometryKey.singleColor) {
+                reuseStage(progress, LoadStage::L2DParse);
+                reuseStage(progress, LoadStage::Expansion);
+            } else {
+                progress.skip(LoadStage::L2DParse);
+                progress.skip(LoadStage::Expansion);
+            }
+            reuseStage(progress, LoadStage::Turtle);
+            reuseStage(progress, LoadStage::LevelOfDetail);
+            job.resultReady = !progress.isCancelled();
+            return;
+        }
+
+        bool generated = renderScene(conf, sink, &progress, memory);
+        if (!generated) {
+            std::cerr << "Unknown render type: " << job.info.renderType << std::endl;
+        }
+        sink.flush();
+        if (!generated || progress.isCancelled()) return;
+
+        // Running out of memory here or failing to write the cache fails the stage like any other
+        progress.begin(LoadStage::LevelOfDetail);
+        job.result = LodPyramid::prepare(lines, finestPixelSize, &progress);
+        job.result.geometryKey = geometryKey.key;
+        if (geometryCache().isEnabled() && !progress.isCancelled()) {
+            geometryCache().store(geometryKey.key, job.result);
+        }
+        progress.finish(LoadStage::LevelOfDetail);
+        job.resultReady = !progress.isCancelled();
+    }
+    catch (ini::ParseException& ex) {
+        std::cerr << "Error parsing file: " << iniFile << ": " << ex.what() << std::endl;
+        progress.failRunning();
+    }
+    catch (LParser::ParserException& ex) {
+        std::cerr << "Error parsing L-System of " << iniFile << ": " << ex.what() << std::endl;
+        progress.failRunning();
+    }
+    catch (std::exception& ex) {
+        std::cerr << "Error loading " << iniFile << ": " << ex.what() << std::endl;
+        progress.failRunning();
+    }
+}
+
+bool SceneStreamer::takeSceneInfo(SceneInfo& info) {
+    if (!current || current->infoTaken || current->progress.isCancelled()) return false;
+    if (current->progress.getState(LoadStage::IniParse) != StageState::Done) return false;
+
+    info = current->info;
+    current->infoTaken = true;
+    return true;
+}
+
+size_t SceneStreamer::drain(GeometryStream& stream, double budgetSeconds) {
+    if (!active) return 0;
+
+    auto start = std::chrono::steady_clock::now();
+    auto budget = std::chrono::duration<double>(budgetSeconds);
+
+    size_t moved = 0;
+    LineChunk chunk(current->arena->resource());
+    while (std::chrono::steady_clock::now() - start < budget && current->ring.tryPop(chunk)) {
+        stream.append(chunk.data(), chunk.size());
+        moved += chunk.size();
+    }
+    stream.flush();
+
+    // Uploading runs on this thread while the worker keeps generating
+    LoadProgress& progress = current->progress;
+    if (moved > 0) {
+        if (progress.getState(LoadStage::Upload) == StageState::Pending) {
+            progress.begin(LoadStage::Upload);
+        }
+        current->uploadedLines += moved;
+        size_t expected = std::max<size_t>(1, progress.getExpectedLines());
+        progress.update(LoadStage::Upload, float(current->uploadedLines) / expected);
+    }
+    return moved;
+}
+
+bool SceneStreamer::takeResult(PreparedPyramid& pyramid) {
+    if (!active || !current->resultReady) return false;
+
+    // Chunks still in the ring are part of the finished scene anyway
+    LineChunk chunk(current->arena->resource());
+    while (current->ring.tryPop(chunk)) {
+    }
+
+    pyramid = std::move(current->result);
+    current->result = PreparedPyramid();
+    active = false;
+    return true;
+}
+
+void SceneStreamer::finishUpload() {
+    if (!current) return;
+
+    LoadProgress& progress = current->progress;
+    if (progress.getState(LoadStage::Upload) == StageState::Pending) {
+        progress.begin(LoadStage::Upload);
+    }
+    progress.finish(LoadStage::Upload, current->geometryReused);
+}
+
+const LoadProgress* SceneStreamer::getProgress() const {
+    return current ? &current->progress : nullptr;
+}
+
+const LoadArena* SceneStreamer::getArena() const {
+    return current ? current->arena.get() : nullptr;
+}
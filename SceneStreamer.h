@@ -0,0 +1,121 @@
+// SceneStreamer.h
+#ifndef SCENESTREAMER_H
+#define SCENESTREAMER_H
+
+#include "GeometryStream.h"
+#include "LevelOfDetail.h"
+#include "LineData.h"
+#include "LoadArena.h"
+#include "LoadProgress.h"
+#include "SpscRing.h"
+#include "external/glm/glm/glm.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+// What the UI needs to know about a scene before its geometry arrives
+struct SceneInfo {
+    std::string renderType;
+    bool hasBackgroundColor;
+    glm::vec3 backgroundColor;
+
+    // The L-System file the scene is generated from, empty for other scenes
+    std::string inputFile;
+
+    SceneInfo();
+};
+
+// Segments handed from the load job to the GL thread, allocated from the load's arena
+typedef std::pmr::vector<LineData> LineChunk;
+
+// Loads a scene as an interactive job on the shared job system: the INI file is parsed, the scene
+// generated and its level-of-detail pyramid prepared there. Segments are handed to the GL thread in
+// fixed-size chunks while they are produced; the finished scene arrives afterwards as a prepared pyramid.
+// L-Systems only start producing once their expansion and a first turtle pass for the bounds are done, since
+// every segment is normalized to those bounds; on deep L-Systems that takes seconds before the first chunk.
+// Every load reports its stages through a LoadProgress and can be cancelled without waiting for the job.
+// Scratch memory of a load comes from a LoadArena that is recycled for the next load once it ends.
+// Stages whose inputs did not change are not run again: L-Systems and their expansions come from
+// lsystemCache(), and geometry that is still uploaded or held by geometryCache() is used again.
+class SceneStreamer {
+private:
+    // Shared with the job running it, so a cancelled load can outlive the streamer's interest in it
+    struct LoadJob {
+        // Declared first so the chunks in the ring are destroyed before it
+        std::shared_ptr<LoadArena> arena;
+        SpscRing<LineChunk> ring;
+        LoadProgress progress;
+        std::atomic<bool> finished;
+        std::atomic<bool> resultReady;
+        bool infoTaken;
+        size_t uploadedLines;
+
+        // Geometry on the GPU when the load started, and whether the load ends up using it again
+        uint64_t uploadedGeometryKey;
+        bool geometryReused;
+
+        // Written by the worker before the IniParse stage is finished
+        SceneInfo info;
+
+        // Written by the worker before resultReady is set
+        PreparedPyramid result;
+
+        explicit LoadJob(std::shared_ptr<LoadArena> arena);
+    };
+
+    // The latest load, kept after it ends so its progress stays visible
+    std::shared_ptr<LoadJob> current;
+    bool active;
+
+    // Cancelled loads whose job has not noticed yet
+    std::vector<std::shared_ptr<LoadJob>> retired;
+
+    // Arena of the last load that ended, kept with its grown buffer for the next one
+    std::shared_ptr<LoadArena> spareArena;
+
+    static void run(LoadJob& job, const std::string& iniFile, float finestPixelSize);
+    static void load(LoadJob& job, const std::string& iniFile, float finestPixelSize);
+    void reapRetired();
+    void recycleArena(LoadJob& job);
+
+public:
+    static const size_t chunkSize = 4096;
+    static const size_t ringCapacity = 256;
+
+    SceneStreamer();
+    ~SceneStreamer();
+
+    SceneStreamer(const SceneStreamer&) = delete;
+    SceneStreamer& operator=(const SceneStreamer&) = delete;
+
+    // Starts loading the scene of iniFile, cancelling any load still in progress. uploadedGeometryKey is the
+    // key of the geometry on the GPU, which is not generated again when the scene turns out to have it.
+    void start(const std::string& iniFile, float finestPixelSize, uint64_t uploadedGeometryKey = 0);
+
+    // Abandons the current load; its worker finishes in the background
+    void cancel();
+
+    // True from start until the result has been taken, the load failed or was cancelled
+    bool isActive();
+
+    // Hands over the render type and background color once the INI file is parsed
+    bool takeSceneInfo(SceneInfo& info);
+
+    // Moves generated chunks into stream until budgetSeconds have passed; returns the number of lines moved
+    size_t drain(GeometryStream& stream, double budgetSeconds);
+
+    // Hands over the finished scene once generation is complete
+    bool takeResult(PreparedPyramid& pyramid);
+
+    // Called after the taken result has been uploaded to the GPU
+    void finishUpload();
+
+    // Progress and arena of the latest load, kept after it ends; nullptr before the first load
+    const LoadProgress* getProgress() const;
+    const LoadArena* getArena() const;
+};
+
+#endif // SCENESTREAMER_H
@@ -0,0 +1,83 @@
+// SceneUniforms.cpp
+#include "SceneUniforms.h"
+
+SceneUniforms::SceneUniforms()
+        : dirty(true) {
+    data.projection = glm::mat4(1.0f);
+    data.view = glm::mat4(1.0f);
+    data.normalization = glm::mat4(1.0f);
+    data.backgroundColor = glm::vec4(0.2f, 0.3f, 0.3f, 1.0f);
+    data.lineWidth = 2.0f;
+    data.padding[0] = data.padding[1] = data.padding[2] = 0.0f;
+    for (int i = 0; i < scenePaletteSize; i++) {
+        data.palette[i] = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+    }
+
+    UBO = GLBuffer::create();
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO.get());
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(SceneUniformData), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void SceneUniforms::setProjection(const glm::mat4& projection) {
+    if (data.projection == projection) return;
+    data.projection = projection;
+    dirty = true;
+}
+
+void SceneUniforms::setView(const glm::mat4& view) {
+    if (data.view == view) return;
+    data.view = view;
+    dirty = true;
+}
+
+void SceneUniforms::setNormalization(const glm::mat4& normalization) {
+    if (data.normalization == normalization) return;
+    data.normalization = normalization;
+    dirty = true;
+}
+
+void SceneUniforms::setBackgroundColor(const glm::vec3& color) {
+    glm::vec4 backgroundColor(color, 1.0f);
+    if (data.backgroundColor == backgroundColor) return;
+    data.backgroundColor = backgroundColor;
+    dirty = true;
+}
+
+void SceneUniforms::setLineWidth(float width) {
+    if (data.lineWidth == width) return;
+    data.lineWidth = width;
+    dirty = true;
+}
+
+void SceneUniforms::setPalette(const std::vector<glm::vec3>& colors) {
+    for (size_t i = 0; i < colors.size() && i < size_t(scenePaletteSize); i++) {
+        glm::vec4 color(colors[i], 1.0f);
+        if (data.palette[i] == color) continue;
+        data.palette[i] = color;
+        dirty = true;
+    }
+}
+
+const glm::vec4& SceneUniforms::getBackgroundColor() const {
+    return data.backgroundColor;
+}
+
+void SceneUniforms::update() {
+    if (dirty) {
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO.get());
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(SceneUniformData), &data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        dirty = false;
+    }
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, UBO.get());
+    glLineWidth(data.lineWidth);
+}
+
+void bindSceneUniforms(GLuint shaderProgram) {
+    GLuint blockIndex = glGetUniformBlockIndex(shaderProgram, "SceneUniforms");
+    if (blockIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(shaderProgram, blockIndex, SceneUniforms::bindingPoint);
+    }
+}
@@ -0,0 +1,66 @@
+// SceneUniforms.h
+#ifndef SCENEUNIFORMS_H
+#define SCENEUNIFORMS_H
+
+#include "GLHandle.h"
+#include "external/glm/glm/glm.hpp"
+#include <vector>
+
+// GLSL declaration of the uniform block, to be pasted into every shader that draws scene geometry
+#define SCENE_UNIFORMS_GLSL "layout (std140) uniform SceneUniforms {\n" \
+                            "   mat4 projection;\n" \
+                            "   mat4 view;\n" \
+                            "   mat4 normalization;\n" \
+                            "   vec4 backgroundColor;\n" \
+                            "   float lineWidth;\n" \
+                            "   vec4 palette[256];\n" \
+                            "};\n"
+
+// Number of palette entries in the SceneUniforms block, matching SceneQuantizer::maxPaletteSize
+const int scenePaletteSize = 256;
+
+// std140 layout of the SceneUniforms block
+struct SceneUniformData {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::mat4 normalization;
+    glm::vec4 backgroundColor;
+    float lineWidth;
+    float padding[3];
+    glm::vec4 palette[scenePaletteSize];
+};
+
+// Camera and per-scene data shared by every program through one uniform buffer.
+// Changes are collected on the CPU and uploaded at most once per frame; setting a value the buffer
+// already holds is not a change, so values can be set every frame without uploading anything.
+class SceneUniforms {
+private:
+    GLBuffer UBO;
+    SceneUniformData data;
+    bool dirty;
+
+public:
+    static const GLuint bindingPoint = 0;
+
+    SceneUniforms();
+
+    SceneUniforms(const SceneUniforms&) = delete;
+    SceneUniforms& operator=(const SceneUniforms&) = delete;
+
+    void setProjection(const glm::mat4& projection);
+    void setView(const glm::mat4& view);
+    void setNormalization(const glm::mat4& normalization);
+    void setBackgroundColor(const glm::vec3& color);
+    void setLineWidth(float width);
+    void setPalette(const std::vector<glm::vec3>& colors);
+
+    const glm::vec4& getBackgroundColor() const;
+
+    // Uploads pending changes and binds the buffer; call once per frame before drawing
+    void update();
+};
+
+// Connects the SceneUniforms block of a linked program to the shared binding point
+void bindSceneUniforms(GLuint shaderProgram);
+
+#endif // SCENEUNIFORMS_H
@@ -0,0 +1,233 @@
+// SegmentBVH.cpp
+#include "SegmentBVH.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <utility>
+
+namespace {
+    // Segments or chunks handled by one job
+    const size_t segmentGrain = 16384;
+    const size_t chunkGrain = 64;
+
+    // Spreads the lower 16 bits of v over the even bits of the result
+    uint32_t spreadBits(uint32_t v) {
+        v &= 0x0000ffff;
+        v = (v | (v << 8)) & 0x00ff00ff;
+        v = (v | (v << 4)) & 0x0f0f0f0f;
+        v = (v | (v << 2)) & 0x33333333;
+        v = (v | (v << 1)) & 0x55555555;
+        return v;
+    }
+
+    typedef std::pair<uint32_t, uint32_t> MortonKey;
+
+    // Sorts keys by their Morton code with a parallel radix sort, eight bits per pass. Every pass is a
+    // counting sort in the way the tile rasterizer bins lines: slots[digit * chunkCount + chunk] counts the
+    // keys of chunk with digit, and scanned in that order every digit gets its keys chunk by chunk. Passes
+    // are stable and the keys start in index order, so the result equals sorting the pairs.
+    void sortMortonKeys(std::vector<MortonKey>& keys) {
+        const size_t digitCount = 256;
+        size_t chunkCount = (keys.size() + segmentGrain - 1) / segmentGrain;
+        auto chunkBegin = [&](size_t chunk) {
+            return std::min(keys.size(), chunk * segmentGrain);
+        };
+
+        std::vector<MortonKey> sorted(keys.size());
+        std::vector<size_t> slots(digitCount * chunkCount);
+        for (int shift = 0; shift < 32; shift += 8) {
+            std::fill(slots.begin(), slots.end(), 0);
+            parallelFor(0, chunkCount, 1, [&](size_t first, size_t last) {
+                for (size_t chunk = first; chunk < last; chunk++) {
+                    for (size_t i = chunkBegin(chunk); i < chunkBegin(chunk + 1); i++) {
+                        slots[((keys[i].first >> shift) & 0xff) * chunkCount + chunk]++;
+                    }
+                }
+            });
+            parallelScan(slots, size_t(0), std::plus<size_t>(), 4096);
+
+            parallelFor(0, chunkCount, 1, [&](size_t first, size_t last) {
+                for (size_t chunk = first; chunk < last; chunk++) {
+                    for (size_t i = chunkBegin(chunk); i < chunkBegin(chunk + 1); i++) {
+                        sorted[slots[((keys[i].first >> shift) & 0xff) * chunkCount + chunk]++] = keys[i];
+                    }
+                }
+            });
+            keys.swap(sorted);
+        }
+    }
+}
+
+Bounds::Bounds()
+        : minX(std::numeric_limits<float>::max()), minY(std::numeric_limits<float>::max()),
+          maxX(std::numeric_limits<float>::lowest()), maxY(std::numeric_limits<float>::lowest()) {
+}
+
+Bounds::Bounds(float minX, float minY, float maxX, float maxY)
+        : minX(minX), minY(minY), maxX(maxX), maxY(maxY) {
+}
+
+void Bounds::expand(const glm::vec3& point) {
+    minX = std::min(minX, point.x);
+    minY = std::min(minY, point.y);
+    maxX = std::max(maxX, point.x);
+    maxY = std::max(maxY, point.y);
+}
+
+void Bounds::expand(const Bounds& other) {
+    minX = std::min(minX, other.minX);
+    minY = std::min(minY, other.minY);
+    maxX = std::max(maxX, other.maxX);
+    maxY = std::max(maxY, other.maxY);
+}
+
+bool Bounds::intersects(const Bounds& other) const {
+    return minX <= other.maxX && other.minX <= maxX &&
+           minY <= other.maxY && other.minY <= maxY;
+}
+
+bool Bounds::isEmpty() const {
+    return minX > maxX || minY > maxY;
+}
+
+void SegmentBVH::build(std::vector<LineData>& lines, int chunkSize) {
+    clear();
+    if (lines.empty()) return;
+
+    Bounds sceneBounds;
+    for (const auto& line : lines) {
+        sceneBounds.expand(line.start);
+        sceneBounds.expand(line.end);
+    }
+
+    // Sort segments along a Morton curve of their midpoints so consecutive segments are close together
+    float extentX = std::max(sceneBounds.maxX - sceneBounds.minX, 1e-12f);
+    float extentY = std::max(sceneBounds.maxY - sceneBounds.minY, 1e-12f);
+    std::vector<MortonKey> keys(lines.size());
+    parallelFor(0, lines.size(), segmentGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            float midX = (lines[i].start.x + lines[i].end.x) * 0.5f;
+            float midY = (lines[i].start.y + lines[i].end.y) * 0.5f;
+            uint32_t gridX = uint32_t((midX - sceneBounds.minX) / extentX * 65535.0f);
+            uint32_t gridY = uint32_t((midY - sceneBounds.minY) / extentY * 65535.0f);
+            keys[i] = std::make_pair(spreadBits(gridX) | (spreadBits(gridY) << 1), uint32_t(i));
+        }
+    });
+    sortMortonKeys(keys);
+
+    std::vector<LineData> sorted(lines.size());
+    parallelFor(0, lines.size(), segmentGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            sorted[i] = lines[keys[i].second];
+        }
+    });
+    lines.swap(sorted);
+
+    // Split into fixed-size chunks and compute their bounds
+    size_t chunkCount = (lines.size() + chunkSize - 1) / chunkSize;
+    chunks.resize(chunkCount);
+    parallelFor(0, chunkCount, chunkGrain, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) {
+            SegmentChunk& chunk = chunks[c];
+            chunk.firstSegment = int(c * chunkSize);
+            chunk.segmentCount = int(std::min<size_t>(chunkSize, lines.size() - chunk.firstSegment));
+            chunk.bounds = Bounds();
+            for (int i = chunk.firstSegment; i < chunk.firstSegment + chunk.segmentCount; i++) {
+                chunk.bounds.expand(lines[i].start);
+                chunk.bounds.expand(lines[i].end);
+            }
+        }
+    });
+
+    // Chunks are already in Morton order, so splitting the range in half gives a reasonable hierarchy
+    nodes.reserve(2 * chunkCount / chunksPerLeaf + 1);
+    buildNode(0, int(chunkCount));
+}
+
+int SegmentBVH::buildNode(int firstChunk, int chunkCount) {
+    int index = int(nodes.size());
+    nodes.push_back(Node());
+    nodes[index].firstChunk = firstChunk;
+    nodes[index].chunkCount = chunkCount;
+
+    if (chunkCount <= chunksPerLeaf) {
+        Bounds bounds;
+        for (int c = firstChunk; c < firstChunk + chunkCount; c++) {
+            bounds.expand(chunks[c].bounds);
+        }
+        nodes[index].bounds = bounds;
+        nodes[index].left = -1;
+        nodes[index].right = -1;
+        return index;
+    }
+
+    int half = chunkCount / 2;
+    int left = buildNode(firstChunk, half);
+    int right = buildNode(firstChunk + half, chunkCount - half);
+
+    Bounds bounds = nodes[left].bounds;
+    bounds.expand(nodes[right].bounds);
+    nodes[index].bounds = bounds;
+    nodes[index].left = left;
+    nodes[index].right = right;
+    return index;
+}
+
+void SegmentBVH::clear() {
+    chunks.clear();
+    nodes.clear();
+}
+
+void SegmentBVH::assign(std::vector<SegmentChunk> newChunks, std::vector<Node> newNodes) {
+    chunks = std::move(newChunks);
+    nodes = std::move(newNodes);
+}
+
+void SegmentBVH::query(const Bounds& view, std::vector<int>& firsts, std::vector<int>& counts) const {
+    firsts.clear();
+    counts.clear();
+    if (nodes.empty()) return;
+
+    // Children are visited left to right, so chunks come out in buffer order and neighbours can be merged
+    int stack[maxDepth + 1];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+        if (!node.bounds.intersects(view)) continue;
+
+        if (node.left >= 0) {
+            stack[top++] = node.right;
+            stack[top++] = node.left;
+            continue;
+        }
+
+        for (int c = node.firstChunk; c < node.firstChunk + node.chunkCount; c++) {
+            const SegmentChunk& chunk = chunks[c];
+            if (!chunk.bounds.intersects(view)) continue;
+
+            int first = chunk.firstSegment * 2;
+            int count = chunk.segmentCount * 2;
+            if (!firsts.empty() && firsts.back() + counts.back() == first) {
+                counts.back() += count;
+            } else {
+                firsts.push_back(first);
+                counts.push_back(count);
+            }
+        }
+    }
+}
+
+const std::vector<SegmentChunk>& SegmentBVH::getChunks() const {
+    return chunks;
+}
+
+const std::vector<SegmentBVH::Node>& SegmentBVH::getNodes() const {
+    return nodes;
+}
+
+Bounds SegmentBVH::getBounds() const {
+    return nodes.empty() ? Bounds() : nodes[0].bounds;
+}
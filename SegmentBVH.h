@@ -0,0 +1,68 @@
+// SegmentBVH.h
+#ifndef SEGMENTBVH_H
+#define SEGMENTBVH_H
+
+#include "LineData.h"
+#include <cstddef>
+#include <vector>
+
+// Axis-aligned bounding box in scene space
+struct Bounds {
+    float minX, minY, maxX, maxY;
+
+    Bounds();
+    Bounds(float minX, float minY, float maxX, float maxY);
+
+    void expand(const glm::vec3& point);
+    void expand(const Bounds& other);
+    bool intersects(const Bounds& other) const;
+    bool isEmpty() const;
+};
+
+// A run of consecutive segments in the vertex buffer together with its bounds
+struct SegmentChunk {
+    int firstSegment;
+    int segmentCount;
+    Bounds bounds;
+};
+
+// Groups segments into spatially coherent chunks and keeps a bounding volume hierarchy over them,
+// so only chunks that overlap the visible area have to be submitted
+class SegmentBVH {
+public:
+    struct Node {
+        Bounds bounds;
+        int left, right;            // child nodes, -1 for leaves
+        int firstChunk, chunkCount; // chunks covered by this node
+    };
+
+private:
+    std::vector<SegmentChunk> chunks;
+    std::vector<Node> nodes;
+
+    int buildNode(int firstChunk, int chunkCount);
+
+public:
+    static const int defaultChunkSize = 256;
+    static const int chunksPerLeaf = 4;
+
+    // Deepest a node may lie below the root, which bounds the stack of query; a built hierarchy halves the
+    // chunks at every level and stays far below it
+    static const int maxDepth = 63;
+
+    // Reorders the lines along a Morton curve, splits them into chunks and builds the hierarchy
+    void build(std::vector<LineData>& lines, int chunkSize = defaultChunkSize);
+    void clear();
+
+    // Takes over chunks and a hierarchy over them built earlier, as read back from a geometry cache
+    void assign(std::vector<SegmentChunk> chunks, std::vector<Node> nodes);
+
+    // Collects vertex ranges of all chunks overlapping view; chunks that are adjacent in the buffer are merged
+    void query(const Bounds& view, std::vector<int>& firsts, std::vector<int>& counts) const;
+
+    const std::vector<SegmentChunk>& getChunks() const;
+    const std::vector<Node>& getNodes() const;
+    Bounds getBounds() const;
+};
+
+#endif // SEGMENTBVH_H
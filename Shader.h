@@ -0,0 +1,10 @@
+// Shader.h
+#ifndef SHADER_H
+#define SHADER_H
+
+#include "GLHandle.h"
+
+// Compiles and links a vertex/fragment shader pair, logging any errors to std::cerr
+GLProgram createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource);
+
+#endif // SHADER_H
@@ -0,0 +1,127 @@
+// SimdFloat.h
+#ifndef SIMDFLOAT_H
+#define SIMDFLOAT_H
+
+// A fixed number of floats processed together on the widest vector unit the build targets:
+// AVX2 (8 lanes), SSE2 or NEON (4 lanes), or plain floats when neither is available.
+// AVX2 is only targeted when the build enables it (METALWORKS_AVX2 in CMake), x86-64 builds use SSE2 otherwise.
+// Every lane gives the same result as it would in any other position.
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+struct FloatBatch {
+    static const int width = 8;
+    __m256 v;
+
+    static FloatBatch broadcast(float x) {
+        return FloatBatch{_mm256_set1_ps(x)};
+    }
+    // 0, 1, 2, ... in consecutive lanes
+    static FloatBatch lanes() {
+        return FloatBatch{_mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7)};
+    }
+    void store(float* out) const {
+        _mm256_storeu_ps(out, v);
+    }
+};
+
+inline FloatBatch operator+(FloatBatch a, FloatBatch b) { return FloatBatch{_mm256_add_ps(a.v, b.v)}; }
+inline FloatBatch operator-(FloatBatch a, FloatBatch b) { return FloatBatch{_mm256_sub_ps(a.v, b.v)}; }
+inline FloatBatch operator*(FloatBatch a, FloatBatch b) { return FloatBatch{_mm256_mul_ps(a.v, b.v)}; }
+inline FloatBatch min(FloatBatch a, FloatBatch b) { return FloatBatch{_mm256_min_ps(a.v, b.v)}; }
+inline FloatBatch max(FloatBatch a, FloatBatch b) { return FloatBatch{_mm256_max_ps(a.v, b.v)}; }
+inline FloatBatch floor(FloatBatch a) { return FloatBatch{_mm256_floor_ps(a.v)}; }
+
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+
+struct FloatBatch {
+    static const int width = 4;
+    __m128 v;
+
+    static FloatBatch broadcast(float x) {
+        return FloatBatch{_mm_set1_ps(x)};
+    }
+    static FloatBatch lanes() {
+        return FloatBatch{_mm_setr_ps(0, 1, 2, 3)};
+    }
+    void store(float* out) const {
+        _mm_storeu_ps(out, v);
+    }
+};
+
+inline FloatBatch operator+(FloatBatch a, FloatBatch b) { return FloatBatch{_mm_add_ps(a.v, b.v)}; }
+inline FloatBatch operator-(FloatBatch a, FloatBatch b) { return FloatBatch{_mm_sub_ps(a.v, b.v)}; }
+inline FloatBatch operator*(FloatBatch a, FloatBatch b) { return FloatBatch{_mm_mul_ps(a.v, b.v)}; }
+inline FloatBatch min(FloatBatch a, FloatBatch b) { return FloatBatch{_mm_min_ps(a.v, b.v)}; }
+inline FloatBatch max(FloatBatch a, FloatBatch b) { return FloatBatch{_mm_max_ps(a.v, b.v)}; }
+
+// SSE2 has no floor: truncate, then step down where that rounded up. Needs |a| < 2^31.
+inline FloatBatch floor(FloatBatch a) {
+    __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+    __m128 roundedUp = _mm_and_ps(_mm_cmpgt_ps(truncated, a.v), _mm_set1_ps(1.0f));
+    return FloatBatch{_mm_sub_ps(truncated, roundedUp)};
+}
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+
+struct FloatBatch {
+    static const int width = 4;
+    float32x4_t v;
+
+    static FloatBatch broadcast(float x) {
+        return FloatBatch{vdupq_n_f32(x)};
+    }
+    static FloatBatch lanes() {
+        const float values[4] = {0, 1, 2, 3};
+        return FloatBatch{vld1q_f32(values)};
+    }
+    void store(float* out) const {
+        vst1q_f32(out, v);
+    }
+};
+
+inline FloatBatch operator+(FloatBatch a, FloatBatch b) { return FloatBatch{vaddq_f32(a.v, b.v)}; }
+inline FloatBatch operator-(FloatBatch a, FloatBatch b) { return FloatBatch{vsubq_f32(a.v, b.v)}; }
+inline FloatBatch operator*(FloatBatch a, FloatBatch b) { return FloatBatch{vmulq_f32(a.v, b.v)}; }
+inline FloatBatch min(FloatBatch a, FloatBatch b) { return FloatBatch{vminq_f32(a.v, b.v)}; }
+inline FloatBatch max(FloatBatch a, FloatBatch b) { return FloatBatch{vmaxq_f32(a.v, b.v)}; }
+inline FloatBatch floor(FloatBatch a) { return FloatBatch{vrndmq_f32(a.v)}; }
+
+#else
+#include <cmath>
+
+struct FloatBatch {
+    static const int width = 4;
+    float v[4];
+
+    static FloatBatch broadcast(float x) {
+        return FloatBatch{{x, x, x, x}};
+    }
+    static FloatBatch lanes() {
+        return FloatBatch{{0, 1, 2, 3}};
+    }
+    void store(float* out) const {
+        for (int i = 0; i < width; i++) out[i] = v[i];
+    }
+};
+
+template <typename Op>
+inline FloatBatch applyLanes(FloatBatch a, FloatBatch b, Op op) {
+    FloatBatch result;
+    for (int i = 0; i < FloatBatch::width; i++) result.v[i] = op(a.v[i], b.v[i]);
+    return result;
+}
+
+inline FloatBatch operator+(FloatBatch a, FloatBatch b) { return applyLanes(a, b, [](float x, float y) { return x + y; }); }
+inline FloatBatch operator-(FloatBatch a, FloatBatch b) { return applyLanes(a, b, [](float x, float y) { return x - y; }); }
+inline FloatBatch operator*(FloatBatch a, FloatBatch b) { return applyLanes(a, b, [](float x, float y) { return x * y; }); }
+inline FloatBatch min(FloatBatch a, FloatBatch b) { return applyLanes(a, b, [](float x, float y) { return y < x ? y : x; }); }
+inline FloatBatch max(FloatBatch a, FloatBatch b) { return applyLanes(a, b, [](float x, float y) { return y > x ? y : x; }); }
+inline FloatBatch floor(FloatBatch a) { return applyLanes(a, a, [](float x, float) { return std::floor(x); }); }
+
+#endif
+
+#endif // SIMDFLOAT_H
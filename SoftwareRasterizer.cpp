@@ -0,0 +1,211 @@
+// SoftwareRasterizer.cpp
+#include "SoftwareRasterizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <utility>
+
+namespace {
+    uint8_t toChannel(double value) {
+        return uint8_t(std::max(0L, std::min(255L, std::lround(value * 255.0))));
+    }
+
+    // Division rounding towards negative infinity; divisor must be positive
+    long long floorDiv(long long dividend, long long divisor) {
+        long long quotient = dividend / divisor;
+        if (dividend % divisor != 0 && dividend < 0) quotient--;
+        return quotient;
+    }
+
+    long long ceilDiv(long long dividend, long long divisor) {
+        return -floorDiv(-dividend, divisor);
+    }
+
+    // Calls plot(major, minor) for the steps [first, last] of walk
+    template <typename Plot>
+    void walkPixels(const LineWalk& walk, long long first, long long last, Plot plot) {
+        if (walk.majorLength == 0) {
+            plot(walk.major0, walk.minor0);
+            return;
+        }
+
+        // Bresenham: the error term is the remainder of the numerator, so every step is one add and one compare
+        long long twoMajor = 2 * walk.majorLength;
+        long long twoMinor = 2 * walk.minorDelta;
+        long long numerator = twoMinor * first + walk.majorLength;
+        long long quotient = floorDiv(numerator, twoMajor);
+        long long error = numerator - quotient * twoMajor;
+        long long minor = walk.minor0 + quotient;
+        long long major = walk.majorAt(first);
+        for (long long i = first; i <= last; i++) {
+            plot(major, minor);
+            major += walk.majorStep;
+            error += twoMinor;
+            if (error >= twoMajor) {
+                error -= twoMajor;
+                minor++;
+            } else if (error < 0) {
+                error += twoMajor;
+                minor--;
+            }
+        }
+    }
+}
+
+PixelColor toPixelColor(const glm::vec3& color) {
+    return PixelColor{toChannel(color.x), toChannel(color.y), toChannel(color.z)};
+}
+
+PixelColor toPixelColor(const std::vector<double>& color) {
+    return PixelColor{toChannel(color[0]), toChannel(color[1]), toChannel(color[2])};
+}
+
+Framebuffer::Framebuffer()
+        : width(0), height(0), firstRow(0) {
+}
+
+Framebuffer::Framebuffer(int width, int height, PixelColor background)
+        : width(0), height(0), firstRow(0) {
+    resize(width, height, background);
+}
+
+void Framebuffer::resize(int newWidth, int newHeight, PixelColor background, int newFirstRow) {
+    width = std::max(0, newWidth);
+    height = std::max(0, newHeight);
+    firstRow = newFirstRow;
+    pixels.resize(size_t(width) * height * 3);
+    clear(background);
+}
+
+void Framebuffer::clear(PixelColor background) {
+    for (size_t i = 0; i < pixels.size(); i += 3) {
+        pixels[i] = background.r;
+        pixels[i + 1] = background.g;
+        pixels[i + 2] = background.b;
+    }
+}
+
+int Framebuffer::getWidth() const {
+    return width;
+}
+
+int Framebuffer::getHeight() const {
+    return height;
+}
+
+int Framebuffer::getFirstRow() const {
+    return firstRow;
+}
+
+PixelRect Framebuffer::getBounds() const {
+    return PixelRect{0, firstRow, width, firstRow + height};
+}
+
+uint8_t* Framebuffer::getRow(int y) {
+    return &pixels[size_t(y - firstRow) * width * 3];
+}
+
+const uint8_t* Framebuffer::getRow(int y) const {
+    return &pixels[size_t(y - firstRow) * width * 3];
+}
+
+PixelColor Framebuffer::getPixel(int x, int y) const {
+    const uint8_t* pixel = &pixels[(size_t(y - firstRow) * width + x) * 3];
+    return PixelColor{pixel[0], pixel[1], pixel[2]};
+}
+
+LineWalk::LineWalk(long x0, long y0, long x1, long y1) {
+    // Start from the endpoint with the smallest x
+    if (x0 > x1 || (x0 == x1 && y0 > y1)) {
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+    }
+    long long dx = x1 - x0;
+    long long dy = y1 - y0;
+
+    yMajor = dx < std::llabs(dy);
+    if (!yMajor) {
+        major0 = x0;
+        minor0 = y0;
+        majorLength = dx;
+        minorDelta = dy;
+        majorStep = 1;
+    } else {
+        major0 = y0;
+        minor0 = x0;
+        majorLength = std::llabs(dy);
+        minorDelta = dx;
+        majorStep = dy > 0 ? 1 : -1;
+    }
+}
+
+long long LineWalk::minorAt(long long i) const {
+    if (majorLength == 0) return minor0;
+    return minor0 + floorDiv(2 * minorDelta * i + majorLength, 2 * majorLength);
+}
+
+bool LineWalk::clip(const PixelRect& rect, long long& first, long long& last) const {
+    long long majorMin = yMajor ? rect.minY : rect.minX;
+    long long majorMax = yMajor ? rect.maxY : rect.maxX;
+    long long minorMin = yMajor ? rect.minX : rect.minY;
+    long long minorMax = yMajor ? rect.maxX : rect.maxY;
+
+    // Clip against the major axis
+    if (majorStep > 0) {
+        first = std::max(first, majorMin - major0);
+        last = std::min(last, majorMax - 1 - major0);
+    } else {
+        first = std::max(first, major0 - (majorMax - 1));
+        last = std::min(last, major0 - majorMin);
+    }
+
+    // Clip against the minor axis by solving minorMin <= minorAt(i) < minorMax for i
+    long long twoMajor = 2 * majorLength;
+    long long twoMinor = 2 * minorDelta;
+    if (minorDelta > 0) {
+        first = std::max(first, ceilDiv((minorMin - minor0) * twoMajor - majorLength, twoMinor));
+        last = std::min(last, ceilDiv((minorMax - minor0) * twoMajor - majorLength, twoMinor) - 1);
+    } else if (minorDelta < 0) {
+        first = std::max(first, floorDiv(majorLength - (minorMax - minor0) * twoMajor, -twoMinor) + 1);
+        last = std::min(last, floorDiv(majorLength - (minorMin - minor0) * twoMajor, -twoMinor));
+    } else if (minor0 < minorMin || minor0 >= minorMax) {
+        return false;
+    }
+    return first <= last;
+}
+
+void drawLine(Framebuffer& framebuffer, long x0, long y0, long x1, long y1, PixelColor color) {
+    drawLine(framebuffer, x0, y0, x1, y1, color, framebuffer.getBounds());
+}
+
+void drawLine(Framebuffer& framebuffer, long x0, long y0, long x1, long y1, PixelColor color, const PixelRect& clip) {
+    LineWalk walk(x0, y0, x1, y1);
+    long long first = 0;
+    long long last = walk.majorLength;
+    if (!walk.clip(clip, first, last)) return;
+
+    if (walk.yMajor) {
+        walkPixels(walk, first, last, [&](long long major, long long minor) {
+            framebuffer.setPixel(int(minor), int(major), color);
+        });
+    } else {
+        walkPixels(walk, first, last, [&](long long major, long long minor) {
+            framebuffer.setPixel(int(major), int(minor), color);
+        });
+    }
+}
+
+void drawLines(Framebuffer& framebuffer, const std::vector<PixelLine>& lines) {
+    PixelRect bounds = framebuffer.getBounds();
+    for (const PixelLine& line : lines) {
+        drawPixelLine(framebuffer, line, bounds);
+    }
+}
+
+void removeRepeatedLines(std::vector<PixelLine>& lines) {
+    auto same = [](const PixelLine& a, const PixelLine& b) {
+        return a.x0 == b.x0 && a.y0 == b.y0 && a.x1 == b.x1 && a.y1 == b.y1 &&
+               a.color.r == b.color.r && a.color.g == b.color.g && a.color.b == b.color.b;
+    };
+    lines.erase(std::unique(lines.begin(), lines.end(), same), lines.end());
+}
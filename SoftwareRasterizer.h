@@ -0,0 +1,109 @@
+// SoftwareRasterizer.h
+#ifndef SOFTWARERASTERIZER_H
+#define SOFTWARERASTERIZER_H
+
+#include "external/glm/glm/glm.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct PixelColor {
+    uint8_t r, g, b;
+};
+
+// Converts a [0, 1] color from a config to 8 bits per channel, rounding to the nearest value
+PixelColor toPixelColor(const glm::vec3& color);
+PixelColor toPixelColor(const std::vector<double>& color);
+
+// Half-open rectangle of pixels [minX, maxX) x [minY, maxY)
+struct PixelRect {
+    long long minX, minY, maxX, maxY;
+};
+
+// 24-bit RGB image in memory. Row 0 is the bottom row, like in a BMP file.
+// It can also hold a band of rows of a taller image, which are then addressed by their row in that image:
+// getRow(firstRow) is the bottom row of the band.
+class Framebuffer {
+private:
+    int width, height;
+    int firstRow;
+    std::vector<uint8_t> pixels;
+
+public:
+    Framebuffer();
+    Framebuffer(int width, int height, PixelColor background);
+
+    void resize(int width, int height, PixelColor background, int firstRow = 0);
+    void clear(PixelColor background);
+
+    int getWidth() const;
+    int getHeight() const;
+    int getFirstRow() const;
+
+    // The pixels held, in image coordinates
+    PixelRect getBounds() const;
+
+    uint8_t* getRow(int y);
+    const uint8_t* getRow(int y) const;
+    PixelColor getPixel(int x, int y) const;
+
+    void setPixel(int x, int y, PixelColor color) {
+        uint8_t* pixel = &pixels[(size_t(y - firstRow) * width + x) * 3];
+        pixel[0] = color.r;
+        pixel[1] = color.g;
+        pixel[2] = color.b;
+    }
+};
+
+// A line as the rasterizer walks it: step i in [0, majorLength] moves the major coordinate to
+// major0 + majorStep * i, and the minor coordinate is minor0 + floor((2 * minorDelta * i + majorLength) / (2 * majorLength)),
+// the exact rounded value with halves rounded up. Steps are counted from the endpoint with the smallest x,
+// which gives the same pixels as the reference renderer.
+struct LineWalk {
+    long long major0, minor0;
+    long long majorLength, minorDelta;
+    int majorStep;
+    bool yMajor;
+
+    LineWalk(long x0, long y0, long x1, long y1);
+
+    long long majorAt(long long i) const {
+        return major0 + majorStep * i;
+    }
+    long long minorAt(long long i) const;
+
+    // Narrows [first, last] to the steps whose pixel lies in rect; false when none are left
+    bool clip(const PixelRect& rect, long long& first, long long& last) const;
+};
+
+// Draws the line from (x0, y0) to (x1, y1), both endpoints included, with integer Bresenham steps.
+// The line is clipped to the framebuffer, or to clip, analytically, so clipping never changes which
+// pixels a visible part covers.
+void drawLine(Framebuffer& framebuffer, long x0, long y0, long x1, long y1, PixelColor color);
+void drawLine(Framebuffer& framebuffer, long x0, long y0, long x1, long y1, PixelColor color, const PixelRect& clip);
+
+// Line in pixel coordinates, ready to be drawn
+struct PixelLine {
+    long x0, y0, x1, y1;
+    PixelColor color;
+};
+
+// Draws line within clip. Dense curves mostly have segments within one pixel; those skip the line setup.
+inline void drawPixelLine(Framebuffer& framebuffer, const PixelLine& line, const PixelRect& clip) {
+    if (line.x0 == line.x1 && line.y0 == line.y1) {
+        if (line.x0 >= clip.minX && line.x0 < clip.maxX && line.y0 >= clip.minY && line.y0 < clip.maxY) {
+            framebuffer.setPixel(int(line.x0), int(line.y0), line.color);
+        }
+        return;
+    }
+    drawLine(framebuffer, line.x0, line.y0, line.x1, line.y1, line.color, clip);
+}
+
+// Draws lines one after the other on this thread
+void drawLines(Framebuffer& framebuffer, const std::vector<PixelLine>& lines);
+
+// Removes every line that equals the one before it, which cannot change the image. Scaled down far enough,
+// a dense curve turns into long runs of the same single pixel.
+void removeRepeatedLines(std::vector<PixelLine>& lines);
+
+#endif // SOFTWARERASTERIZER_H
@@ -0,0 +1,68 @@
+// SpscRing.h
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Lock-free bounded queue for exactly one producer thread and one consumer thread
+template <typename T>
+class SpscRing {
+private:
+    std::vector<T> slots;
+    size_t mask;
+
+    // Written by the consumer and the producer respectively; kept on separate cache lines
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity)
+            : SpscRing(capacity, []() { return T(); }) {
+    }
+
+    // Creates every slot with make(), e.g. to give allocator-aware slots their allocator
+    template <typename Make>
+    SpscRing(size_t capacity, Make make)
+            : head(0), tail(0) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        slots.reserve(size);
+        for (size_t i = 0; i < size; i++) {
+            slots.push_back(make());
+        }
+        mask = size - 1;
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer side; returns false when the ring is full
+    bool tryPush(T&& value) {
+        size_t currentTail = tail.load(std::memory_order_relaxed);
+        if (currentTail - head.load(std::memory_order_acquire) == slots.size()) return false;
+
+        slots[currentTail & mask] = std::move(value);
+        tail.store(currentTail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side; returns false when the ring is empty
+    bool tryPop(T& value) {
+        size_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead == tail.load(std::memory_order_acquire)) return false;
+
+        value = std::move(slots[currentHead & mask]);
+        head.store(currentHead + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool isEmpty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+};
+
+#endif // SPSCRING_H
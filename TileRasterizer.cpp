@@ -0,0 +1,117 @@
+// TileRasterizer.cpp
+#include "TileRasterizer.h"
+#include "JobSystem.h"
+#include <cstdint>
+#include <functional>
+
+namespace {
+    // Lines binned by one job, and the most of those jobs per worker
+    const size_t binGrain = 16384;
+    const size_t binChunksPerWorker = 4;
+
+    // Tiles drawn by one job
+    const size_t tileGrain = 4;
+
+    // Positions of the lines of one tile, in order
+    struct TileLines {
+        const uint32_t* first;
+        const uint32_t* last;
+
+        const uint32_t* begin() const {
+            return first;
+        }
+        const uint32_t* end() const {
+            return last;
+        }
+    };
+
+    // Bins lines into tiles with forEachTile(line, bounds, tileSize, visit) and draws every tile with
+    // drawTile(tileLines, clip), which gets the lines of the tile in their original order.
+    // A job draws its tiles one after the other with the state made by makeTileState().
+    template <typename Line, typename ForEachTile, typename MakeTileState, typename DrawTile>
+    void rasterizeBinned(Framebuffer& framebuffer, const std::vector<Line>& lines, int tileSize,
+                         ForEachTile forEachTile, MakeTileState makeTileState, DrawTile drawTile) {
+        size_t workerCount = jobSystem().getThreadCount();
+
+        PixelRect bounds{0, 0, framebuffer.getWidth(), framebuffer.getHeight()};
+        size_t tilesX = (size_t(framebuffer.getWidth()) + tileSize - 1) / tileSize;
+        size_t tilesY = (size_t(framebuffer.getHeight()) + tileSize - 1) / tileSize;
+        size_t tileCount = tilesX * tilesY;
+
+        // The lines are split into chunks that are binned in parallel. slots[tile * chunkCount + chunk] counts
+        // the lines of chunk that touch tile; scanned in that order, every tile gets its lines chunk by chunk,
+        // which keeps them in their original order.
+        size_t chunkCount = std::max<size_t>(1, std::min((lines.size() + binGrain - 1) / binGrain,
+                                                        workerCount * binChunksPerWorker));
+        std::vector<size_t> slots(tileCount * chunkCount, 0);
+        auto chunkBegin = [&](size_t chunk) {
+            return lines.size() * chunk / chunkCount;
+        };
+
+        parallelFor(0, chunkCount, 1, [&](size_t first, size_t last) {
+            for (size_t chunk = first; chunk < last; chunk++) {
+                for (size_t i = chunkBegin(chunk); i < chunkBegin(chunk + 1); i++) {
+                    forEachTile(lines[i], bounds, tileSize, [&](long long tileX, long long tileY) {
+                        slots[(size_t(tileY) * tilesX + size_t(tileX)) * chunkCount + chunk]++;
+                    });
+                }
+            }
+        });
+        size_t total = parallelScan(slots, size_t(0), std::plus<size_t>(), 4096);
+
+        // Second pass: every slot moves to the start of the next one while its lines are written
+        std::vector<uint32_t> tileLines(total);
+        parallelFor(0, chunkCount, 1, [&](size_t first, size_t last) {
+            for (size_t chunk = first; chunk < last; chunk++) {
+                for (size_t i = chunkBegin(chunk); i < chunkBegin(chunk + 1); i++) {
+                    forEachTile(lines[i], bounds, tileSize, [&](long long tileX, long long tileY) {
+                        tileLines[slots[(size_t(tileY) * tilesX + size_t(tileX)) * chunkCount + chunk]++] = uint32_t(i);
+                    });
+                }
+            }
+        });
+
+        parallelFor(0, tileCount, tileGrain, [&](size_t first, size_t last) {
+            auto state = makeTileState();
+            for (size_t tile = first; tile < last; tile++) {
+                long long tileX = (long long)(tile % tilesX) * tileSize;
+                long long tileY = (long long)(tile / tilesX) * tileSize;
+                PixelRect clip{tileX, tileY, std::min(tileX + tileSize, bounds.maxX), std::min(tileY + tileSize, bounds.maxY)};
+
+                size_t begin = tile == 0 ? 0 : slots[tile * chunkCount - 1];
+                size_t end = slots[(tile + 1) * chunkCount - 1];
+                drawTile(state, TileLines{tileLines.data() + begin, tileLines.data() + end}, clip);
+            }
+        });
+    }
+}
+
+void rasterizeTiled(Framebuffer& framebuffer, const std::vector<PixelLine>& lines, int tileSize) {
+    if (jobSystem().getThreadCount() <= 1) {
+        drawLines(framebuffer, lines);
+        return;
+    }
+    auto forEachTile = [](const PixelLine& line, const PixelRect& bounds, int tileSize, auto visit) {
+        forEachLineTile(line, bounds, tileSize, visit);
+    };
+    auto makeTileState = [] { return 0; };
+    rasterizeBinned(framebuffer, lines, tileSize, forEachTile, makeTileState,
+                    [&](int, const TileLines& tileLines, const PixelRect& clip) {
+        for (uint32_t index : tileLines) {
+            drawPixelLine(framebuffer, lines[index], clip);
+        }
+    });
+}
+
+void rasterizeTiledSmooth(Framebuffer& framebuffer, const std::vector<SmoothLine>& lines, int tileSize) {
+    // Also binned with a single worker, which keeps the coverage of sub-pixel segments to one tile
+    auto forEachTile = [](const SmoothLine& line, const PixelRect& bounds, int tileSize, auto visit) {
+        forEachSmoothLineTile(line, bounds, tileSize, visit);
+    };
+    auto makeTileState = [&] { return CoverageAccumulator(PixelRect{0, 0, tileSize, tileSize}); };
+    rasterizeBinned(framebuffer, lines, tileSize, forEachTile, makeTileState,
+                    [&](CoverageAccumulator& accumulator, const TileLines& tileLines, const PixelRect& clip) {
+        accumulator.reset(clip);
+        drawSmoothLines(framebuffer, lines, tileLines, clip, accumulator);
+    });
+}
@@ -0,0 +1,51 @@
+// TileRasterizer.h
+#ifndef TILERASTERIZER_H
+#define TILERASTERIZER_H
+
+#include "AntialiasedRasterizer.h"
+#include "SoftwareRasterizer.h"
+#include <algorithm>
+#include <vector>
+
+// Side of the square tiles the framebuffer is split into
+const int rasterTileSize = 64;
+
+// Calls visit(tileX, tileY) once for every tile in which line covers a pixel inside bounds
+template <typename Visit>
+void forEachLineTile(const PixelLine& line, const PixelRect& bounds, int tileSize, Visit visit) {
+    LineWalk walk(line.x0, line.y0, line.x1, line.y1);
+    long long first = 0;
+    long long last = walk.majorLength;
+    if (!walk.clip(bounds, first, last)) return;
+
+    // One span of steps per tile along the major axis; the minor coordinate is monotonic within it
+    while (first <= last) {
+        long long majorTile = walk.majorAt(first) / tileSize;
+        long long spanLast = walk.majorStep > 0 ? (majorTile + 1) * tileSize - 1 - walk.major0
+                                                : walk.major0 - majorTile * tileSize;
+        spanLast = std::min(spanLast, last);
+
+        long long minorFirst = walk.minorAt(first);
+        long long minorLast = walk.minorAt(spanLast);
+        long long firstTile = std::min(minorFirst, minorLast) / tileSize;
+        long long lastTile = std::max(minorFirst, minorLast) / tileSize;
+        for (long long minorTile = firstTile; minorTile <= lastTile; minorTile++) {
+            if (walk.yMajor) {
+                visit(minorTile, majorTile);
+            } else {
+                visit(majorTile, minorTile);
+            }
+        }
+        first = spanLast + 1;
+    }
+}
+
+// Draws lines on the job system. Lines are binned into tiles of tileSize pixels, then every tile is drawn
+// by one worker in the order of lines, clipped to the tile. Workers never write the same pixel, and the
+// result is identical to drawLines.
+void rasterizeTiled(Framebuffer& framebuffer, const std::vector<PixelLine>& lines, int tileSize = rasterTileSize);
+
+// Same for anti-aliased lines; the result is identical to drawSmoothLines
+void rasterizeTiledSmooth(Framebuffer& framebuffer, const std::vector<SmoothLine>& lines, int tileSize = rasterTileSize);
+
+#endif // TILERASTERIZER_H
@@ -7,44 +7,48 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 #include "Line.h"
+#include "BatchRenderer.h"
+#include "FileWatcher.h"
+#include "GeometryCache.h"
+#include "GeometryStream.h"
+#include "HeadlessRenderer.h"
+#include "JobSystem.h"
+#include "LevelOfDetail.h"
+#include "LSystemCache.h"
+#include "ParameterSweep.h"
+#include "RedrawScheduler.h"
+#include "RenderDaemon.h"
+#include "SceneGenerator.h"
+#include "SceneStreamer.h"
+#include "SceneUniforms.h"
 #include "ini_configuration.h"
-#include "l_parser.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
 #include <iostream>
 #include <fstream>
 #include <stdexcept>
 #include <string>
 #include <cmath>
+#include <cstdlib>
+#include <filesystem>
 #include <vector>
-#include <stack>
-#include <set>
 
 
 
 
 using namespace glm;
 
-// Structure to hold line data
-struct LineData {
-    vec3 start;
-    vec3 end;
-    vec3 color;
-};
-
 // Global variables
-std::vector<LineData> linesData;
 std::string currentRenderType = "None";
-ini::Configuration currentConfig;
-bool configLoaded = false;
 
 // Function prototypes
 void glfw_error_callback(int error, const char* description);
 GLFWwindow* initializeOpenGL();
 void initializeImGui(GLFWwindow* window);
-void renderRectangle(const ini::Configuration &conf);
-void renderBlocks(const ini::Configuration &conf);
-void renderL2D(const ini::Configuration &conf);
-void renderScene(const ini::Configuration &conf);
-void loadConfiguration(const std::string& fileName);
+void showLoadProgress(const LoadProgress& progress);
+void runViewer(GLFWwindow* window);
+int renderHeadless(const std::vector<std::string>& files, const BatchOptions& options);
 
 void glfw_error_callback(int error, const char* description) {
     std::cerr << "GLFW Error: " << description << std::endl;
@@ -78,290 +82,103 @@ GLFWwindow* initializeOpenGL() {
 }
 
 void initializeImGui(GLFWwindow* window) {
+    // Installed first so ImGui chains them from its own callbacks
+    installRedrawCallbacks(window);
+
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 330 core");
 }
 
-// Function to load and parse INI configuration
-void loadConfiguration(const std::string& fileName) {
-    try {
-        std::ifstream fin(fileName);
-        if (fin.peek() == std::istream::traits_type::eof()) {
-            std::cout << "Ini file appears empty. Does '" << fileName << "' exist?" << std::endl;
-            configLoaded = false;
-            return;
-        }
-        fin >> currentConfig;
-        fin.close();
-        configLoaded = true;
-
-        // Get render type
-        currentRenderType = currentConfig["General"]["type"].as_string_or_die();
-        std::cout << "Loaded configuration with type: " << currentRenderType << std::endl;
-    }
-    catch(ini::ParseException& ex) {
-        std::cerr << "Error parsing file: " << fileName << ": " << ex.what() << std::endl;
-        configLoaded = false;
-    }
-}
-
-// Creates lines for a colored rectangle
-void renderRectangle(const ini::Configuration &conf) {
-    linesData.clear();
-
-    int width = (conf["ImageProperties"]["width"].as_int_or_die());
-    int height = (conf["ImageProperties"]["height"].as_int_or_die());
-
-    // For a rectangle, we'll just create the border lines
-    LineData line1, line2, line3, line4;
-
-    // Define rectangle corners
-    vec3 topLeft(-0.8f, 0.8f, 0.0f);
-    vec3 topRight(0.8f, 0.8f, 0.0f);
-    vec3 bottomRight(0.8f, -0.8f, 0.0f);
-    vec3 bottomLeft(-0.8f, -0.8f, 0.0f);
-
-    // Define colors
-    vec3 redColor(1.0f, 0.0f, 0.0f);
-    vec3 greenColor(0.0f, 1.0f, 0.0f);
-    vec3 blueColor(0.0f, 0.0f, 1.0f);
-    vec3 yellowColor(1.0f, 1.0f, 0.0f);
-
-    // Create the four sides of the rectangle
-    line1.start = topLeft;
-    line1.end = topRight;
-    line1.color = redColor;
-
-    line2.start = topRight;
-    line2.end = bottomRight;
-    line2.color = greenColor;
-
-    line3.start = bottomRight;
-    line3.end = bottomLeft;
-    line3.color = blueColor;
-
-    line4.start = bottomLeft;
-    line4.end = topLeft;
-    line4.color = yellowColor;
-
-    // Add lines to the global vector
-    linesData.push_back(line1);
-    linesData.push_back(line2);
-    linesData.push_back(line3);
-    linesData.push_back(line4);
-}
+// One row per stage of the latest load: progress, time taken and peak resident memory
+void showLoadProgress(const LoadProgress& progress) {
+    static const char* stateNames[] = {"pending", "running", "done", "cached", "skipped", "cancelled", "failed"};
 
-// Creates lines for a checkerboard pattern
-void renderBlocks(const ini::Configuration &conf) {
-    linesData.clear();
-
-    int nrXBlocks = (conf["BlockProperties"]["nrXBlocks"].as_int_or_die());
-    int nrYBlocks = (conf["BlockProperties"]["nrYBlocks"].as_int_or_die());
-    std::vector<double> colorA = (conf["BlockProperties"]["colorWhite"].as_double_tuple_or_die());
-    std::vector<double> colorB = (conf["BlockProperties"]["colorBlack"].as_double_tuple_or_die());
-
-    // Convert the configuration colors to vec3
-    vec3 colorAvec(colorA[0], colorA[1], colorA[2]);
-    vec3 colorBvec(colorB[0], colorB[1], colorB[2]);
-
-    // Create a grid of lines to represent the checkerboard
-    float blockWidth = 1.6f / nrXBlocks;
-    float blockHeight = 1.6f / nrYBlocks;
-    float startX = -0.8f;
-    float startY = -0.8f;
-
-    // Create horizontal grid lines
-    for (int y = 0; y <= nrYBlocks; y++) {
-        LineData line;
-        line.start = vec3(startX, startY + y * blockHeight, 0.0f);
-        line.end = vec3(startX + nrXBlocks * blockWidth, startY + y * blockHeight, 0.0f);
-        line.color = vec3(0.5f, 0.5f, 0.5f); // Gray lines
-        linesData.push_back(line);
-    }
+    for (int i = 0; i < loadStageCount; i++) {
+        LoadStage stage = LoadStage(i);
+        StageState state = progress.getState(stage);
+        if (state == StageState::Skipped) continue;
 
-    // Create vertical grid lines
-    for (int x = 0; x <= nrXBlocks; x++) {
-        LineData line;
-        line.start = vec3(startX + x * blockWidth, startY, 0.0f);
-        line.end = vec3(startX + x * blockWidth, startY + nrYBlocks * blockHeight, 0.0f);
-        line.color = vec3(0.5f, 0.5f, 0.5f); // Gray lines
-        linesData.push_back(line);
+        ImGui::ProgressBar(progress.getFraction(stage), ImVec2(120.0f, 0.0f));
+        ImGui::SameLine();
+        ImGui::Text("%-16s %7.3f s %7.1f MB  %s", LoadProgress::getStageName(stage), progress.getSeconds(stage),
+                    progress.getPeakMemory(stage) / (1024.0 * 1024.0), stateNames[int(state)]);
     }
 }
 
-// Renders an L-System 2D drawing
-void renderL2D(const ini::Configuration &conf) {
-    linesData.clear();
-
-    int size = (conf["General"]["size"].as_int_or_die());
-    std::vector<double> backgroundColor = (conf["General"]["backgroundcolor"].as_double_tuple_or_die());
-    std::vector<double> lineColor = (conf["2DLSystem"]["color"].as_double_tuple_or_die());
-    std::string L2DFileName = (conf["2DLSystem"]["inputfile"].as_string_or_die());
-
-    // Convert the line color to vec3
-    vec3 lineColorVec(lineColor[0], lineColor[1], lineColor[2]);
-
-    // Load L-System
-    LParser::LSystem2D LPARSER;
-    std::ifstream L2DFile(L2DFileName);
-    if (!L2DFile) {
-        std::cerr << "Failed to open L-System file: " << L2DFileName << std::endl;
-        return;
-    }
-
-    L2DFile >> LPARSER;
-    L2DFile.close();
-
-    std::set<char> alphabet = LPARSER.get_alphabet();
-
-    // Generate the L-System string
-    std::string mainstring = LPARSER.get_initiator();
-    std::string tempstring;
-    for(int i = 0; i < LPARSER.get_nr_iterations(); i++) {
-        tempstring = "";
-        for(char c: mainstring) {
-            if(alphabet.find(c) != alphabet.end()) {
-                tempstring += LPARSER.get_replacement(c);
-            } else {
-                tempstring += c;
-            }
-        }
-        mainstring = tempstring;
-    }
-
-    // Trace the path to collect line segments
-    double currentX = 0;
-    double currentY = 0;
-    double nextX = 0;
-    double nextY = 0;
-    double currentAngle = LPARSER.get_starting_angle() * (M_PI / 180);
-    double angle = LPARSER.get_angle() * (M_PI / 180);
-
-    std::stack<double> positionX;
-    std::stack<double> positionY;
-    std::stack<double> positionAngle;
-
-    for(char c: mainstring) {
-        if(alphabet.find(c) != alphabet.end()) {
-            if(LPARSER.draw(c) != false) {
-                nextX = currentX + LPARSER.draw(c) * cos(currentAngle);
-                nextY = currentY + LPARSER.draw(c) * sin(currentAngle);
-
-                LineData line;
-                line.start = vec3(currentX, currentY, 0.0f);
-                line.end = vec3(nextX, nextY, 0.0f);
-                line.color = lineColorVec;
-                linesData.push_back(line);
-
-                currentX = nextX;
-                currentY = nextY;
-            } else {
-                currentX = currentX + LPARSER.draw(c) * cos(currentAngle);
-                currentY = currentY + LPARSER.draw(c) * sin(currentAngle);
-            }
-        }
-        if(c == '+') {
-            currentAngle += angle;
-        }
-        else if(c == '-') {
-            currentAngle -= angle;
-        } else if(c == '(') {
-            positionX.push(currentX);
-            positionY.push(currentY);
-            positionAngle.push(currentAngle);
-        } else if(c == ')') {
-            currentX = positionX.top();
-            currentY = positionY.top();
-            currentAngle = positionAngle.top();
-            positionX.pop();
-            positionY.pop();
-            positionAngle.pop();
-        }
-    }
-
-    // Normalize coordinates
-    if (!linesData.empty()) {
-        // Find min and max
-        float minX = linesData[0].start.x;
-        float maxX = minX;
-        float minY = linesData[0].start.y;
-        float maxY = minY;
-
-        for (const auto& line : linesData) {
-            minX = std::min(minX, std::min(line.start.x, line.end.x));
-            maxX = std::max(maxX, std::max(line.start.x, line.end.x));
-            minY = std::min(minY, std::min(line.start.y, line.end.y));
-            maxY = std::max(maxY, std::max(line.start.y, line.end.y));
-        }
-
-        // Calculate scale factor
-        float width = maxX - minX;
-        float height = maxY - minY;
-        float scale = 1.6f / std::max(width, height);
-
-        // Center and scale
-        float centerX = (minX + maxX) / 2.0f;
-        float centerY = (minY + maxY) / 2.0f;
-
-        for (auto& line : linesData) {
-            line.start.x = (line.start.x - centerX) * scale;
-            line.start.y = (line.start.y - centerY) * scale;
-            line.end.x = (line.end.x - centerX) * scale;
-            line.end.y = (line.end.y - centerY) * scale;
-        }
+// Writes image.format, or the Deep Zoom pyramid image.dzi with PNG tiles, for every image.ini, rendering the
+// files concurrently, and prints how long each took; returns the exit code
+int renderHeadless(const std::vector<std::string>& files, const BatchOptions& options) {
+    LSystemCache& cache = lsystemCache();
+    auto start = std::chrono::steady_clock::now();
+    std::vector<BatchResult> results = renderBatch(files, options, cache);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printBatchSummary(std::cout, results, seconds, cache);
+
+    for (const BatchResult& result : results) {
+        if (!result.rendered) return 1;
     }
+    return 0;
 }
 
-// Main render function that calls the appropriate renderer
-void renderScene(const ini::Configuration &conf) {
-    if (conf["General"]["type"].as_string_or_die() == "IntroColorRectangle") {
-        renderRectangle(conf);
-    }
-    else if (conf["General"]["type"].as_string_or_die() == "IntroBlocks") {
-        renderBlocks(conf);
-    }
-    else if (conf["General"]["type"].as_string_or_die() == "2DLSystem") {
-        renderL2D(conf);
+// Renders the frames of ranges for every file, sharing L-System expansions between them; returns the exit code
+int renderSweeps(const std::vector<std::string>& files, const std::vector<SweepRange>& ranges,
+                 const std::string& format) {
+    LSystemCache& cache = lsystemCache();
+    int failures = 0;
+    for (const std::string& file : files) {
+        if (file.empty()) continue;
+        if (!renderSweep(file, ranges, format, cache)) failures++;
     }
+    return failures == 0 ? 0 : 1;
 }
 
-int main(int argc, char* argv[]) {
-    GLFWwindow* window = initializeOpenGL();
-    if (!window) return -1;
-
-    initializeImGui(window);
+// Serves render requests on socketPath until one asks for a shutdown; returns the exit code
+int serveRenders(const std::string& socketPath, size_t memoryBudget, const std::string& outputDirectory,
+                 bool overwrite) {
+    RenderDaemon daemon(socketPath, memoryBudget, outputDirectory, overwrite, lsystemCache());
+    return daemon.run() ? 0 : 1;
+}
 
-    // Set up projection matrix
-    mat4 projection = ortho(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f);
-    mat4 view = mat4(1.0f);
-    mat4 model = mat4(1.0f);
-    mat4 MVP = projection * view * model;
+// Shows the window until it is closed. Everything holding GL objects or posting GLFW events lives in here,
+// so it is released while the context still exists.
+void runViewer(GLFWwindow* window) {
+    // Camera and per-scene data shared by all programs
+    SceneUniforms sceneUniforms;
+    sceneUniforms.setProjection(ortho(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f));
 
     // Default line (will be replaced when configuration is loaded)
     Line defaultLine(vec3(-0.5f, 0.0f, 0.0f), vec3(0.5f, 0.0f, 0.0f));
-    defaultLine.setMVP(MVP);
 
-    // Vector to store Line objects
-    std::vector<Line> lines;
+    // Maximum value of the Zoom slider, used to size the finest level of detail
+    const float maxZoom = 5.0f;
 
-    // Process command line arguments
-    std::vector<std::string> fileArgs;
-    if (argc > 1) {
-        fileArgs = std::vector<std::string>(argv + 1, argv + argc);
-    } else {
-        // Try to read from filelist if no arguments provided
-        std::ifstream fileIn("filelist");
-        std::string filelistName;
-        while (std::getline(fileIn, filelistName)) {
-            fileArgs.push_back(filelistName);
-        }
-    }
+    // All segments of the loaded scene, with simplified copies for zoomed-out views
+    LodPyramid lodPyramid;
+
+    // Scene generation runs on a worker; its segments are shown while they arrive
+    SceneStreamer sceneStreamer;
+    GeometryStream geometryStream;
+    const double uploadBudget = 0.004;
+
+    // Redraw only when something changed instead of every vsync
+    bool renderOnDemand = true;
+    const double idleTimeout = 0.5;
+
+    // Reloads the scene when its INI or L-System file is saved, and measures how long until it is shown
+    const double reloadDebounce = 0.15;
+    FileWatcher fileWatcher(requestRedraw, reloadDebounce);
+    std::string loadedIniFile;
+    bool hotReload = true;
+    bool reloadPending = false;
+    bool reloadShown = false;
+    FileWatcher::Clock::time_point reloadEditTime;
+    double reloadLatency = -1.0;
 
     // Main loop
     while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
+        if (!waitForRedraw(renderOnDemand, idleTimeout)) continue;
 
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -373,71 +190,271 @@ int main(int argc, char* argv[]) {
         static char iniFilePath[256] = "";
         ImGui::InputText("INI File Path", iniFilePath, IM_ARRAYSIZE(iniFilePath));
 
+        // Parse and generate in the background; the levels of detail are uploaded once the scene is complete.
+        // The current scene stays until then, since the new one may turn out to have the same geometry.
+        auto startLoad = [&](const std::string& iniFile) {
+            int framebufferWidth, framebufferHeight;
+            glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+            sceneStreamer.start(iniFile, 2.0f / (maxZoom * std::max(framebufferWidth, framebufferHeight)),
+                                lodPyramid.getGeometryKey());
+
+            geometryStream.reset(Bounds(-sceneExtent, -sceneExtent, sceneExtent, sceneExtent));
+            requestRedraw();
+        };
+
         if (ImGui::Button("Load Configuration")) {
-            loadConfiguration(iniFilePath);
-            if (configLoaded) {
-                renderScene(currentConfig);
-
-                // Create Line objects from lineData
-                lines.clear();
-                for (const auto& data : linesData) {
-                    Line line(data.start, data.end);
-                    line.setMVP(MVP);
-                    line.setColor(data.color);
-                    lines.push_back(line);
-                }
+            loadedIniFile = iniFilePath;
+            fileWatcher.watch({loadedIniFile});
+            reloadPending = false;
+            startLoad(loadedIniFile);
+        }
+
+        // Saving the loaded files loads the scene again, through the stage caches
+        ImGui::Checkbox("Hot Reload", &hotReload);
+        FileWatcher::Clock::time_point editTime;
+        if (fileWatcher.takeChange(editTime) && hotReload && !loadedIniFile.empty()) {
+            reloadPending = true;
+            reloadEditTime = editTime;
+            startLoad(loadedIniFile);
+        }
+        if (reloadLatency >= 0.0) {
+            ImGui::SameLine();
+            ImGui::Text("last edit to pixels: %.1f ms (%.0f ms debounce)", 1000.0 * reloadLatency,
+                        1000.0 * reloadDebounce);
+        }
+
+        bool loading = sceneStreamer.isActive();
+        if (loading) {
+            ImGui::SameLine();
+            if (ImGui::Button("Cancel Load")) {
+                sceneStreamer.cancel();
+                requestRedraw();
+            }
+        }
+
+        // Applied as soon as the worker has parsed the INI file
+        SceneInfo sceneInfo;
+        if (sceneStreamer.takeSceneInfo(sceneInfo)) {
+            fileWatcher.watch({loadedIniFile, sceneInfo.inputFile});
+            currentRenderType = sceneInfo.renderType;
+            if (sceneInfo.hasBackgroundColor) {
+                sceneUniforms.setBackgroundColor(sceneInfo.backgroundColor);
+            } else {
+                sceneUniforms.setBackgroundColor(vec3(0.2f, 0.3f, 0.3f));
             }
         }
 
         ImGui::Text("Current Render Type: %s", currentRenderType.c_str());
-        ImGui::Text("Number of Lines: %zu", lines.size());
+        if (loading) {
+            ImGui::Text("Generating... %zu lines so far", geometryStream.getSegmentCount());
+        }
+        if (const LoadProgress* progress = sceneStreamer.getProgress()) {
+            showLoadProgress(*progress);
+        }
+        if (const LoadArena* arena = sceneStreamer.getArena()) {
+            ImGui::Text("Load arena: %.1f MB used, %zu heap allocations", arena->getUsedBytes() / (1024.0 * 1024.0),
+                        arena->getHeapAllocations());
+        }
+        LSystemCache& cache = lsystemCache();
+        ImGui::Text("Stage caches: L2D parsed %zu of %zu, expanded %zu of %zu, geometry mapped %zu of %zu",
+                    cache.getSystemLoads(), cache.getSystemRequests(),
+                    cache.getExpansionLoads() - cache.getExpansionDiskLoads(), cache.getExpansionRequests(),
+                    geometryCache().getHits(), geometryCache().getRequests());
+        ImGui::Text("Number of Lines: %zu", lodPyramid.getSegmentCount());
+        ImGui::Text("Detail Level: %zu of %zu (%zu lines)", lodPyramid.getCurrentLevel(), lodPyramid.getLevelCount(),
+                    lodPyramid.getLevelSegmentCount());
+        ImGui::Text("Visible Lines: %zu (%zu draw ranges, %zu chunks)", lodPyramid.getVisibleSegmentCount(),
+                    lodPyramid.getDrawRangeCount(), lodPyramid.getChunkCount());
 
         // Controls for camera/view
         static float zoom = 1.0f;
         static float panX = 0.0f;
         static float panY = 0.0f;
 
-        if (ImGui::SliderFloat("Zoom", &zoom, 0.1f, 5.0f)) {
-            projection = ortho(-1.0f/zoom, 1.0f/zoom, -1.0f/zoom, 1.0f/zoom, -1.0f, 1.0f);
-            MVP = projection * view * model;
-
-            for (auto& line : lines) {
-                line.setMVP(MVP);
-            }
+        if (ImGui::SliderFloat("Zoom", &zoom, 0.1f, maxZoom)) {
+            sceneUniforms.setProjection(ortho(-1.0f/zoom, 1.0f/zoom, -1.0f/zoom, 1.0f/zoom, -1.0f, 1.0f));
+            requestRedraw();
         }
 
         if (ImGui::SliderFloat("Pan X", &panX, -2.0f, 2.0f) ||
             ImGui::SliderFloat("Pan Y", &panY, -2.0f, 2.0f)) {
 
-            view = translate(mat4(1.0f), vec3(panX, panY, 0.0f));
-            MVP = projection * view * model;
+            sceneUniforms.setView(translate(mat4(1.0f), vec3(panX, panY, 0.0f)));
+            requestRedraw();
+        }
+
+        ImGui::Checkbox("Render On Demand", &renderOnDemand);
 
-            for (auto& line : lines) {
-                line.setMVP(MVP);
+        ImGui::End();
+
+        // Take over what the generator produced since the last frame, within the upload budget
+        if (sceneStreamer.isActive()) {
+            sceneStreamer.drain(geometryStream, uploadBudget);
+
+            PreparedPyramid pyramid;
+            if (sceneStreamer.takeResult(pyramid)) {
+                lodPyramid.upload(std::move(pyramid));
+                sceneStreamer.finishUpload();
+                geometryStream.reset(Bounds(-sceneExtent, -sceneExtent, sceneExtent, sceneExtent));
+                reloadShown = reloadPending;
+                reloadPending = false;
             }
+            requestRedraw();
         }
 
-        ImGui::End();
+        // Segments streamed by a load replace the previous scene as soon as the first of them arrive
+        bool streaming = geometryStream.getSegmentCount() > 0;
+        if (streaming || lodPyramid.getSegmentCount() == 0) {
+            sceneUniforms.setNormalization(geometryStream.getQuantizer().getDequantization());
+            sceneUniforms.setPalette(geometryStream.getQuantizer().getPalette());
+        } else {
+            sceneUniforms.setNormalization(lodPyramid.getQuantizer().getDequantization());
+            sceneUniforms.setPalette(lodPyramid.getQuantizer().getPalette());
+        }
 
         // Render
-        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+        const vec4& clearColor = sceneUniforms.getBackgroundColor();
+        glClearColor(clearColor.x, clearColor.y, clearColor.z, clearColor.w);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        // Draw all lines
-        for (auto& line : lines) {
-            line.draw();
-        }
-
-        // If no lines loaded yet, show default line
-        if (lines.empty()) {
+        // Upload camera changes once for all programs
+        sceneUniforms.update();
+
+        // Visible area in scene coordinates: the inverse of the zoom and pan transform
+        Bounds visibleArea(-1.0f / zoom - panX, -1.0f / zoom - panY, 1.0f / zoom - panX, 1.0f / zoom - panY);
+
+        // Size of one pixel in scene coordinates, which decides the level of detail
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        float pixelSize = 2.0f / (zoom * std::max(1, std::max(framebufferWidth, framebufferHeight)));
+
+        // Draw only the chunks of the chosen level that overlap the visible area,
+        // or everything streamed so far while the scene is still being generated
+        if (streaming) {
+            geometryStream.draw();
+        } else if (lodPyramid.getSegmentCount() > 0) {
+            lodPyramid.draw(visibleArea, pixelSize);
+        } else {
+            // If no lines loaded yet, show default line
             defaultLine.draw();
         }
 
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
         glfwSwapBuffers(window);
+
+        // A reloaded scene is on screen once the GPU has finished this frame
+        if (reloadShown) {
+            glFinish();
+            reloadLatency = std::chrono::duration<double>(FileWatcher::Clock::now() - reloadEditTime).count();
+            reloadShown = false;
+            requestRedraw();
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    // Process command line arguments; --threads N sets the number of job system workers,
+    // --headless renders every file to an image without opening a window, within --memory-budget MB,
+    // or to a Deep Zoom pyramid of PNG tiles with --dzi; --format bmp|png|qoi picks the image format.
+    // Every --sweep parameter=from:to:steps renders numbered frames across those values instead.
+    // --lsystem-cache DIR keeps expanded L-Systems in DIR for later runs, and --geometry-cache DIR the
+    // prepared geometry of every scene opened in the window, which is mapped back when it is opened again.
+    // --daemon SOCKET keeps running and renders what is asked over the Unix socket SOCKET instead.
+    // Images of --headless and --daemon go next to their ini files, or into --output DIR, and only
+    // replace existing files with --force.
+    std::vector<std::string> fileArgs;
+    bool headless = false;
+    bool deepZoom = false;
+    std::string format;
+    std::vector<SweepRange> sweepRanges;
+    std::string daemonSocket;
+    size_t memoryBudget = defaultMemoryBudget;
+    std::string outputDirectory;
+    bool overwrite = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            setJobThreadCount(unsigned(std::strtoul(argv[++i], nullptr, 10)));
+        } else if (arg == "--memory-budget" && i + 1 < argc) {
+            memoryBudget = size_t(std::strtoull(argv[++i], nullptr, 10)) << 20;
+        } else if (arg == "--format" && i + 1 < argc) {
+            format = argv[++i];
+        } else if (arg == "--sweep" && i + 1 < argc) {
+            SweepRange range;
+            if (!parseSweepRange(argv[++i], range)) return 1;
+            sweepRanges.push_back(range);
+        } else if (arg == "--lsystem-cache" && i + 1 < argc) {
+            lsystemCache().setDirectory(argv[++i]);
+        } else if (arg == "--geometry-cache" && i + 1 < argc) {
+            geometryCache().setDirectory(argv[++i]);
+        } else if (arg == "--daemon" && i + 1 < argc) {
+            daemonSocket = argv[++i];
+        } else if (arg == "--output" && i + 1 < argc) {
+            outputDirectory = argv[++i];
+        } else if (arg == "--force") {
+            overwrite = true;
+        } else if (arg == "--dzi") {
+            deepZoom = true;
+        } else if (arg == "--headless") {
+            headless = true;
+        } else {
+            fileArgs.push_back(arg);
+        }
+    }
+    if (!outputDirectory.empty()) {
+        std::error_code error;
+        std::filesystem::create_directories(outputDirectory, error);
+        if (error) {
+            std::cerr << "Failed to create output directory " << outputDirectory << ": " << error.message()
+                      << std::endl;
+            return 1;
+        }
+    }
+    if (!daemonSocket.empty()) return serveRenders(daemonSocket, memoryBudget, outputDirectory, overwrite);
+    if (fileArgs.empty()) {
+        // Try to read from filelist if no arguments provided
+        std::ifstream fileIn("filelist");
+        std::string filelistName;
+        while (std::getline(fileIn, filelistName)) {
+            fileArgs.push_back(filelistName);
+        }
+    }
+
+    // Any other format would be written as BMP, over the input itself for --format ini
+    if (!format.empty() && !isImageFormat(format)) {
+        std::cerr << "Unknown image format '" << format << "'; --format takes bmp, png or qoi" << std::endl;
+        return 1;
+    }
+    std::transform(format.begin(), format.end(), format.begin(), [](unsigned char c) {
+        return char(std::tolower(c));
+    });
+
+    // Images default to BMP, which banded rendering can write beyond the memory budget; tiles and frames to PNG
+    if (deepZoom && !format.empty() && format != "png") {
+        std::cerr << "Deep Zoom tiles are written as PNG, which web viewers can show; --format " << format
+                  << " cannot be used with --dzi" << std::endl;
+        return 1;
+    }
+    if (format.empty()) format = deepZoom || !sweepRanges.empty() ? "png" : "bmp";
+    if (!sweepRanges.empty()) return renderSweeps(fileArgs, sweepRanges, format);
+    if (headless) {
+        BatchOptions options;
+        options.format = format;
+        options.deepZoom = deepZoom;
+        options.memoryBudget = memoryBudget;
+        options.outputDirectory = outputDirectory;
+        options.overwrite = overwrite;
+        return renderHeadless(fileArgs, options);
     }
 
+    GLFWwindow* window = initializeOpenGL();
+    if (!window) return -1;
+
+    initializeImGui(window);
+
+    runViewer(window);
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();